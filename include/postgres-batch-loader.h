@@ -0,0 +1,216 @@
+/**
+ * Copyright (c) 2016 Philippe FERDINAND
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ **/
+#pragma once
+
+#include "postgres-connection.h"
+
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <future>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace db {
+  namespace postgres {
+
+    /**
+     * Coalesce concurrent lookups by key into a single query.
+     *
+     * Threads calling load() within a short window share one execution of a
+     * query selecting the rows of all their keys at once. The query takes the
+     * array of the keys as its single parameter and must return the key of
+     * each row in one of its columns:
+     *
+     * ```
+     * BatchLoader<int32_t> employees(cnx,
+     *   "SELECT emp_no, first_name FROM employees WHERE emp_no = ANY($1)");
+     *
+     * // On any thread
+     * auto future = employees.load(10001);
+     * auto &rows = future.get();  // owned by the future
+     * for (auto &row: rows) {
+     *   std::string name = row.as<std::string>(1);
+     * }
+     * ```
+     *
+     * A batch is sent once the first key has waited for `window` or once
+     * `maxKeys` distinct keys are pending. Identical keys pending at the same
+     * time are only sent once and share the same future. The rows are
+     * returned as snapshots, in the order of the query, and a key matching no
+     * row gets an empty vector. If the query fails, the futures of all the
+     * keys of the batch hold the exception.
+     *
+     * The queries are executed by a background thread: the connection must
+     * not be used elsewhere until the loader is destroyed. `Key` must be
+     * ordered by `operator <` and bindable as an array (see Params).
+     **/
+    template<typename Key>
+    class BatchLoader {
+    public:
+
+      typedef std::vector<RowSnapshot> rows_type;
+
+      /**
+       * Constructor.
+       *
+       * @param cnx       The connection used to execute the queries.
+       * @param sql       The query, taking the array of keys as `$1`.
+       * @param keyColumn The column of the result holding the key of a row.
+       * @param maxKeys   Maximum number of keys in a batch.
+       * @param window    Maximum time a key waits for other keys.
+       **/
+      BatchLoader(Connection &cnx, const char *sql, int keyColumn = 0,
+                  size_t maxKeys = 256,
+                  std::chrono::microseconds window = std::chrono::microseconds(1000))
+      : cnx_(cnx), sql_(sql), keyColumn_(keyColumn), maxKeys_(maxKeys),
+        window_(window), stop_(false) {
+        assert(maxKeys_ > 0);
+        thread_ = std::thread(&BatchLoader::loop, this);
+      }
+
+      /**
+       * Destructor.
+       *
+       * The pending keys are loaded before the destructor returns.
+       **/
+      ~BatchLoader() {
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          stop_ = true;
+        }
+        wakeup_.notify_one();
+        thread_.join();
+      }
+
+      /**
+       * Load the rows of a key.
+       *
+       * @param key The key.
+       * @return The future rows of the key.
+       **/
+      std::shared_future<rows_type> load(const Key &key) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = pending_.find(key);
+        if (it == pending_.end()) {
+          if (pending_.empty()) {
+            first_ = std::chrono::steady_clock::now();
+          }
+          it = pending_.insert(std::make_pair(key, Waiter())).first;
+          it->second.future = it->second.promise.get_future().share();
+          if (pending_.size() == maxKeys_) {
+            wakeup_.notify_one();
+          }
+        }
+        return it->second.future;
+      }
+
+    private:
+
+      /**
+       * The waiters of a key.
+       **/
+      struct Waiter {
+        std::promise<rows_type>      promise;
+        std::shared_future<rows_type> future;
+      };
+
+      Connection               &cnx_;
+      std::string               sql_;
+      int                       keyColumn_;
+      size_t                    maxKeys_;
+      std::chrono::microseconds window_;
+
+      std::mutex                mutex_;    /**< Protect the members below. **/
+      std::condition_variable   wakeup_;   /**< Signal a full batch or stop. **/
+      std::map<Key, Waiter>     pending_;  /**< Keys not sent yet. **/
+      std::chrono::steady_clock::time_point first_; /**< First pending key. **/
+      bool                      stop_;
+      std::thread               thread_;
+
+      /**
+       * Main loop of the background thread.
+       **/
+      void loop() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+          wakeup_.wait(lock, [&] { return stop_ || !pending_.empty(); });
+          if (pending_.empty()) {
+            return;
+          }
+          wakeup_.wait_until(lock, first_ + window_, [&] {
+            return stop_ || pending_.size() >= maxKeys_;
+          });
+
+          std::map<Key, Waiter> batch;
+          while (!pending_.empty() && batch.size() < maxKeys_) {
+            batch.insert(std::move(*pending_.begin()));
+            pending_.erase(pending_.begin());
+          }
+
+          lock.unlock();
+          execute(batch);
+          lock.lock();
+        }
+      }
+
+      /**
+       * Execute the query for a batch of keys and route the rows.
+       **/
+      void execute(std::map<Key, Waiter> &batch) {
+        std::map<Key, rows_type> rows;
+        try {
+          std::vector<Key> keys;
+          keys.reserve(batch.size());
+          for (auto &waiter: batch) {
+            keys.push_back(waiter.first);
+          }
+          for (auto &row: cnx_.execute(sql_.c_str(), keys)) {
+            RowSnapshot snapshot = row.snapshot();
+            Key key = snapshot.as<Key>(keyColumn_);
+            if (batch.find(key) != batch.end()) {
+              rows[key].push_back(std::move(snapshot));
+            }
+          }
+        }
+        catch (...) {
+          std::exception_ptr error = std::current_exception();
+          for (auto &waiter: batch) {
+            waiter.second.promise.set_exception(error);
+          }
+          return;
+        }
+        for (auto &waiter: batch) {
+          waiter.second.promise.set_value(std::move(rows[waiter.first]));
+        }
+      }
+
+      BatchLoader(const BatchLoader&) = delete;
+      BatchLoader& operator = (const BatchLoader&) = delete;
+    };
+
+  } // namespace postgres
+}   // namespace db
@@ -0,0 +1,109 @@
+/**
+ * Copyright (c) 2016 Philippe FERDINAND
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ **/
+#pragma once
+
+#include "postgres-types.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace db {
+  namespace postgres {
+
+    /**
+     * A PostgreSQL type as described by the `pg_type` catalog.
+     **/
+    struct TypeInfo {
+      Oid         oid = 0;      /**< OID of the type. **/
+      Oid         arrayOid = 0; /**< OID of arrays of the type (0 if none). **/
+      Oid         baseOid = 0;  /**< Base type of a domain (0 for other types). **/
+      char        kind = 0;     /**< `b` base, `c` composite, `d` domain, `e` enum, `p` pseudo or `r` range type. **/
+      std::string name;         /**< Name of the type. **/
+      std::vector<std::string> labels; /**< Labels of an enum type in their sort order. **/
+    };
+
+    /**
+     * A cache of the types of a database.
+     *
+     * Enums, domains and types created by extensions (hstore, citext...) have
+     * OIDs that are specific to each database. The catalog keeps the
+     * description of those types once they have been loaded from `pg_type`
+     * by Connection::type(), so that they are loaded only once per connection.
+     *
+     * A catalog can be shared by all the connections to the same database
+     * using Settings::types, in which case the types are loaded only once for
+     * all of them.
+     *
+     * ```
+     * Settings settings;
+     * settings.types = std::make_shared<TypeCatalog>();
+     * Connection cnx1(settings), cnx2(settings);
+     * ```
+     **/
+    class TypeCatalog {
+
+      friend class Connection;
+
+    public:
+
+      TypeCatalog() = default;
+
+      /**
+       * Find a type already loaded in the catalog.
+       *
+       * @param name The name of the type, as given to Connection::type().
+       * @return The type or nullptr if the type is not in the catalog.
+       **/
+      const TypeInfo *find(const std::string &name) const;
+
+      /**
+       * Find a type already loaded in the catalog.
+       *
+       * @param oid The OID of the type.
+       * @return The type or nullptr if the type is not in the catalog.
+       **/
+      const TypeInfo *find(Oid oid) const;
+
+    private:
+      mutable std::mutex mutex_;
+      std::unordered_map<std::string, std::shared_ptr<TypeInfo>> names_;
+      std::unordered_map<Oid, std::shared_ptr<TypeInfo>> oids_;
+
+      /**
+       * Add a type loaded from the database.
+       *
+       * @param name The name used to look up the type (can be empty).
+       * @param type The type.
+       * @return The type in the catalog, which is the one already loaded if
+       *         another connection added the same type in the meantime.
+       **/
+      const TypeInfo &add(const std::string &name, TypeInfo &&type);
+
+      TypeCatalog(const TypeCatalog&) = delete;
+      TypeCatalog& operator = (const TypeCatalog&) = delete;
+    };
+
+  } // namespace postgres
+}   // namespace db
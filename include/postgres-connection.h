@@ -21,16 +21,48 @@
  **/
 #pragma once
 
+#include "postgres-catalog.h"
 #include "postgres-params.h"
 #include "postgres-result.h"
+#include "postgres-single-flight.h"
+#include "postgres-statements.h"
+#include "postgres-exceptions.h"
 
+#include <chrono>
 #include <functional>
 #include <memory>
 #include <cstddef>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
 
 namespace db {
   namespace postgres {
 
+    namespace internal {
+
+      /**
+       * The decayed types of the parameters of a function, a lambda or a
+       * function object.
+       **/
+      template<typename F>
+      struct callable_traits : callable_traits<decltype(&F::operator())> {};
+
+      template<typename R, typename... A>
+      struct callable_traits<R (*)(A...)> {
+        typedef std::tuple<typename std::decay<A>::type...> args;
+      };
+
+      template<typename C, typename R, typename... A>
+      struct callable_traits<R (C::*)(A...)> : callable_traits<R (*)(A...)> {};
+
+      template<typename C, typename R, typename... A>
+      struct callable_traits<R (C::*)(A...) const> : callable_traits<R (*)(A...)> {};
+
+    } // namespace internal
+
     /**
      * Settings of a PostgreSQL connection.
      *
@@ -43,6 +75,40 @@ namespace db {
        * considered as null values.
        **/
       bool emptyStringAsNull = true;
+
+      /**
+       * Cache of the types resolved at runtime (see Connection::type()).
+       *
+       * The same catalog can be shared by the connections to a same
+       * database so that each type is looked up only once. If null, each
+       * connection uses its own catalog.
+       **/
+      std::shared_ptr<TypeCatalog> types;
+
+      /**
+       * Queries shared by executeShared() (see SingleFlight).
+       *
+       * If null (the default), executeShared() always executes the query.
+       * Queries are only shared by connections to the same server and
+       * database, as the same user and, when the server reports it
+       * (PostgreSQL 18 and later), with the same `search_path`. Any other
+       * state the results depend on, such as a role set by `SET ROLE` or the
+       * `search_path` of older servers, must be the same for all the
+       * connections sharing a SingleFlight.
+       **/
+      std::shared_ptr<SingleFlight> flights;
+
+      /**
+       * Default timeout of the commands (see Connection::timeout()). Zero, the
+       * default, means no timeout.
+       **/
+      std::chrono::milliseconds timeout = std::chrono::milliseconds(0);
+
+      /**
+       * Statements prepared when the connection is opened (see
+       * StatementRegistry).
+       **/
+      std::shared_ptr<StatementRegistry> statements;
     };
 
     /**
@@ -51,6 +117,8 @@ namespace db {
     class Connection : public std::enable_shared_from_this<Connection> {
 
       friend class Result;
+      friend class Params;
+      friend class LargeObject;
 
       public:
       
@@ -84,7 +152,13 @@ namespace db {
          * ```
          *
          * @see https://www.postgresql.org/docs/9.5/static/libpq-connect.html#LIBPQ-CONNSTRING
+         * The statements of Settings::statements are prepared once the
+         * connection is opened, in a single round trip.
+         *
          * @return The connection itself.
+         * @throw ConnectionException if the connection failed.
+         * @throw ExecutionException if a statement of Settings::statements
+         *        cannot be prepared.
          **/
         Connection &connect(const char *connInfo = nullptr);
       
@@ -104,10 +178,46 @@ namespace db {
          * can't use anymore the connection since the previous query might still
          * be in progress.
          *
+         * The cancel request is sent with a handle created when the connection
+         * is opened, so this method can be called from another thread.
+         *
          * @return The connection ifself.
          **/
         Connection &cancel();
 
+        /**
+         * Set the timeout of the next commands.
+         *
+         * Each command executed after this call must complete within the
+         * timeout, which starts when the command is sent and includes the
+         * time spent fetching the rows of its result. When the timeout
+         * expires, the command is cancelled, its pending results are
+         * discarded and a TimeoutException is thrown. The connection can
+         * then be used for the next command. If the server does not answer
+         * the cancel request within the timeout, the connection is closed
+         * instead of waiting for the command to complete.
+         *
+         * ```
+         * try {
+         *   cnx.timeout(std::chrono::milliseconds(200)).execute("SELECT ...");
+         * }
+         * catch (TimeoutException &e) {
+         *   ...
+         * }
+         * ```
+         *
+         * Rows fetched by Result::prefetch() are not subject to the timeout.
+         *
+         * @param timeout The timeout, or zero to wait without limit.
+         * @return The connection ifself.
+         **/
+        Connection &timeout(std::chrono::milliseconds timeout) noexcept;
+
+        /**
+         * Timeout of the commands.
+         **/
+        std::chrono::milliseconds timeout() const noexcept;
+
         /**
          * Execute one or more SQL commands.
          *
@@ -116,19 +226,21 @@ namespace db {
          *        If parameters are used, they are referred to in the `sql`
          *        command as `$1`, `$2`, etc... The PostgreSQL datatype of a
          *        parameter is deducted from the C++ type of the parameter
-         *        according to the following table:
+         *        according to the following table. Arguments are taken by
+         *        reference: strings and bytes are sent directly from the
+         *        memory of the caller, without copy.
 
            SQL Type                    | C++ Param
            ----------------------------|-----------------------------
            boolean                     | bool
-           bytea                       | std::vector\<uint_8\>
+           bytea                       | std::vector\<uint_8\>, db::postgres::bytea_view
            "char"                      | char
            bigint                      | int64_t
            smallint                    | int16_t
            integer                     | int32_t
            real                        | float
            double precision            | double
-           character varying           | const char *, std::string
+           character varying           | const char *, std::string, std::string_view
            date                        | db::postgres::date_t
            time without time zone      | db::postgres::time_t
            timestamp without time zone | db::postgres::timestamp_t
@@ -192,13 +304,138 @@ namespace db {
          *
          **/
         template<typename... Args>
-        Result &execute(const char *sql, Args... args) {
-          Params params(settings_, sizeof...(args));
+        Result &execute(const char *sql, Args&&... args) {
+          Params params(*this, sizeof...(args));
+          std::make_tuple((params.bind(std::forward<Args>(args)), 0)...);
+          executeParams(sql, params);
+          return result_;
+        }
+
+        /**
+         * Prepare a statement.
+         *
+         * The statement is parsed and planned once by the server, and the
+         * types of its parameters are kept by the connection. The arguments
+         * given to executePrepared() are then encoded in the exact types
+         * expected by the server: integers are widened or narrowed, date and
+         * timestamp strings are parsed client side, and other strings are
+         * sent in text format. No cast is required in the SQL.
+         *
+         * ```
+         * cnx.prepare("hire", "UPDATE employees SET hire_date = $1 WHERE emp_no = $2");
+         * cnx.executePrepared("hire", "1988-02-10", int64_t(10020)); // date, integer
+         * ```
+         *
+         * Statements shared by all the connections can also be declared in
+         * a StatementRegistry.
+         *
+         * @param name  The name of the statement.
+         * @param sql   A single SQL command.
+         * @param types The types of the parameters. Missing types and types
+         *              set to 0 are inferred by the server.
+         * @return The connection itself.
+         **/
+        Connection &prepare(const char *name, const char *sql,
+                            const std::vector<Oid> &types = std::vector<Oid>());
+
+        /**
+         * Execute a prepared statement.
+         *
+         * @param name The name of the statement (see prepare()).
+         * @param args Parameters of the statement, converted to the types of
+         *             its parameters (see prepare()).
+         * @return The result of the statement (see execute()).
+         * @throw ExecutionException if the statement has not been prepared
+         *        nor declared in Settings::statements, or if an argument
+         *        cannot be converted.
+         **/
+        template<typename... Args>
+        Result &executePrepared(const char *name, Args&&... args) {
+          Params params(*this, sizeof...(args));
           std::make_tuple((params.bind(std::forward<Args>(args)), 0)...);
-          execute(sql, params);
+          executePreparedParams(name, params);
           return result_;
         }
 
+        /**
+         * Execute a SQL command and call a function for each row.
+         *
+         * The parameters of the function define the columns expected in the
+         * result: the value of the first column is passed as the first
+         * parameter, and so on. The C++ type of each parameter follows the
+         * same rules as Row::as(). The shape of the result is checked once,
+         * then the function is called for each row without the overhead of
+         * the Result::iterator.
+         *
+         * ```
+         * cnx.stream("SELECT emp_no, first_name FROM employees WHERE gender=$1", 'F',
+         *   [&](int32_t emp_no, const char *first_name) {
+         *     ...
+         *   });
+         * ```
+         *
+         * @param sql  A single SQL command.
+         * @param args Zero or more parameters of the SQL command (see
+         *             execute()), followed by the function to call for each
+         *             row.
+         * @return The number of rows.
+         *
+         * @throw ExecutionException if the result has less columns than the
+         *        number of parameters of the function, or if the type of a
+         *        parameter is not compatible with its column.
+         **/
+        template<typename... Args>
+        uint64_t stream(const char *sql, Args&&... args) {
+          static_assert(sizeof...(Args) > 0, "the last argument of stream() must be a function");
+          return executeStream(sql,
+                               typename internal::make_index_sequence<sizeof...(Args) - 1>::type(),
+                               std::forward_as_tuple(std::forward<Args>(args)...));
+        }
+
+        /**
+         * Execute a SQL command and load all the rows of the result in memory.
+         *
+         * Unlike execute(), the rows are not fetched one by one from the
+         * server but all at once when the command completes. This is
+         * convenient for results that must be decoded in parallel (see
+         * BufferedResult::decode()).
+         *
+         * @param sql  A single SQL command.
+         * @param args Zero or more parameters of the SQL command (see execute()).
+         * @return The result of the SQL command.
+         **/
+        template<typename... Args>
+        BufferedResult executeBuffered(const char *sql, Args&&... args) {
+          Params params(*this, sizeof...(args));
+          std::make_tuple((params.bind(std::forward<Args>(args)), 0)...);
+          return BufferedResult(executeBufferedParams(sql, params));
+        }
+
+        /**
+         * Execute a SQL command, sharing its result with identical commands
+         * in progress.
+         *
+         * Commands are identical when they have the same SQL and the same
+         * parameters once encoded. Only the first of the identical commands
+         * executed at the same time by connections sharing the same
+         * Settings::flights is sent to the server, the others wait for its
+         * result (see SingleFlight). If the command fails, all of them throw
+         * the same exception.
+         *
+         * Only read-only commands should be shared.
+         *
+         * @param sql  A single SQL command.
+         * @param args Zero or more parameters of the SQL command (see execute()).
+         * @return The result of the SQL command, shared by the identical
+         *         commands.
+         **/
+        template<typename... Args>
+        std::shared_ptr<const BufferedResult> executeShared(const char *sql, Args&&... args) {
+          Params params(*this, sizeof...(args));
+          std::make_tuple((params.bind(std::forward<Args>(args)), 0)...);
+          return executeSharedParams(sql, params);
+        }
+
         /**
          * Start a transaction.
          *
@@ -228,6 +465,66 @@ namespace db {
          **/
         Connection &rollback();
 
+        /**
+         * Set run-time parameters of the session.
+         *
+         * The connection keeps track of the values of the parameters, either
+         * reported by the server (such as `TimeZone` or `application_name`)
+         * or set by this method. Parameters already set to the requested
+         * value are skipped and the other ones are set in a single round
+         * trip, as with `SET name TO value`.
+         *
+         * ```
+         * cnx.set({ { "search_path", "app" }, { "statement_timeout", "5s" }, { "work_mem", "64MB" } });
+         * ```
+         *
+         * The values of the parameters not reported by the server are
+         * forgotten after a `SET`, `RESET`, `DISCARD` or `ROLLBACK` command
+         * and after a command fails. Changes made by calling `set_config()`
+         * in a query or in a function are not tracked: the connection may
+         * then skip a value that is no longer set.
+         *
+         * @param parameters The names and values of the parameters.
+         * @return The connection itself.
+         **/
+        Connection &set(const std::vector<std::pair<std::string, std::string>> &parameters);
+
+        /**
+         * Set a run-time parameter of the session (see set()).
+         **/
+        Connection &set(const std::string &name, const std::string &value);
+
+        /**
+         * Value of a run-time parameter of the session.
+         *
+         * @param name The name of the parameter.
+         * @return The value reported by the server or set by set(), or else
+         *         the current value queried from the server.
+         **/
+        std::string parameter(const std::string &name);
+
+        /**
+         * Type of the database by name.
+         *
+         * The OIDs of types such as enums, domains or types created by
+         * extensions are specific to each database. The type is looked up in
+         * `pg_type` the first time it is requested, then kept in the catalog
+         * of the connection (see Settings::types).
+         *
+         * Do not call this method while iterating over a result: the lookup
+         * executes a query on the connection.
+         *
+         * @param name Name of the type, optionally qualified by its schema.
+         * @return The type information.
+         * @throw ExecutionException if the type does not exist.
+         **/
+        const TypeInfo &type(const char *name);
+
+        /**
+         * Type of the database by OID (see type(const char *)).
+         **/
+        const TypeInfo &type(Oid oid);
+
       protected:
 
         PGconn *pgconn_;  /**< The native connection pointer. **/
@@ -266,10 +563,157 @@ namespace db {
          **/
         int transaction_;
 
+        PGcancel *pgcancel_;                /**< Cancel handle of the connection. **/
+        std::chrono::milliseconds timeout_; /**< Timeout of the commands. **/
+        std::chrono::steady_clock::time_point deadline_; /**< Of the current command. **/
+
+        /**
+         * Start the timeout of a command.
+         **/
+        void startTimeout() noexcept;
+
+        /**
+         * Wait for the next result of the current command.
+         *
+         * @return The next result, or nullptr when the command is complete.
+         * @throw TimeoutException if the deadline of the command has passed.
+         **/
+        PGresult *getResult();
+
+        /**
+         * Wait until the next result can be read without blocking.
+         *
+         * @return 1 if it can, 0 if the deadline has passed and -1 if the
+         *         socket cannot be polled (see errno).
+         **/
+        int waitResult(std::chrono::steady_clock::time_point deadline);
+
+        /**
+         * Cancel the current command and discard its pending results, closing
+         * the connection if they are not received within the timeout.
+         *
+         * @return false if the connection has been closed.
+         **/
+        bool abandon() noexcept;
+
+        /**
+         * Discard the pending results of the current command.
+         **/
+        void discard() noexcept;
+
+        /**
+         * Wait for the last result of the current command, like PQexec().
+         *
+         * @throw ExecutionException if the command failed.
+         **/
+        PGresult *lastResult();
+
+        /**
+         * Values of the known run-time parameters, by lower case name.
+         **/
+        std::unordered_map<std::string, std::string> parameters_;
+
+        /**
+         * Value of a parameter if known without a query, nullptr otherwise.
+         **/
+        const std::string *knownParameter(const std::string &name);
+
+        /**
+         * Forget the known parameters if the result of a command may have
+         * changed them.
+         **/
+        void received(PGresult *pgresult) noexcept;
+
+        /**
+         * Parameter types of the prepared statements by name.
+         **/
+        std::unordered_map<std::string, std::vector<Oid>> prepared_;
+
+        /**
+         * Keep the types of the parameters of a prepared statement.
+         *
+         * @param name     The name of the statement.
+         * @param pgresult The description of the statement.
+         **/
+        void described(const std::string &name, const PGresult *pgresult);
+
+        /**
+         * Prepare the statements of Settings::statements.
+         **/
+        void prepareStatements();
+
+#ifdef LIBPQ_HAS_PIPELINING
+        /**
+         * Leave the pipeline mode, discarding the pending results.
+         *
+         * @param synced True if the synchronization point has been sent.
+         **/
+        void exitPipeline(bool synced) noexcept;
+#endif
+
+        /**
+         * Private implementation of the executePrepared public method.
+         **/
+        void executePreparedParams(const char *name, Params &params);
+
+        /**
+         * Native connection, once the current result has been cleared.
+         **/
+        PGconn *idle();
+
         /**
          * Private implementation of the exectute public method.
          **/
-        void execute(const char *sql, const Params &params);
+        void executeParams(const char *sql, const Params &params);
+
+        /**
+         * Private implementation of the stream public method.
+         **/
+        template<size_t... I, typename Tuple>
+        uint64_t executeStream(const char *sql, internal::index_sequence<I...>, Tuple args) {
+          Params params(*this, sizeof...(I));
+          std::make_tuple((params.bind(std::get<I>(args)), 0)...);
+          executeParams(sql, params);
+
+          auto &callback = std::get<sizeof...(I)>(args);
+          typedef typename std::decay<decltype(callback)>::type Callback;
+          typedef typename internal::callable_traits<Callback>::args Columns;
+          return streamRows(callback,
+                            static_cast<Columns *>(nullptr),
+                            typename internal::make_index_sequence<std::tuple_size<Columns>::value>::type());
+        }
+
+        template<typename Callback, typename Columns, size_t... I>
+        uint64_t streamRows(Callback &callback, Columns *, internal::index_sequence<I...>) {
+          uint64_t rows = 0;
+          if (result_.status_ == PGRES_SINGLE_TUPLE) {
+            if (PQnfields(result_) < int(sizeof...(I))) {
+              throw ExecutionException("The result has less columns than the parameters of the stream function.");
+            }
+            bool accepted[] = { true, type_traits<typename std::tuple_element<I, Columns>::type>::accepts(PQftype(result_, int(I)))... };
+            for (bool accepts: accepted) {
+              if (!accepts) {
+                throw ExecutionException("A parameter of the stream function is not compatible with the type of its column.");
+              }
+            }
+          }
+          while (result_.status_ == PGRES_SINGLE_TUPLE) {
+            callback(result_.as<typename std::tuple_element<I, Columns>::type>(int(I))...);
+            rows++;
+            result_.next();
+          }
+          return rows;
+        }
+
+        /**
+         * Private implementation of the exectuteBuffered public method.
+         **/
+        PGresult *executeBufferedParams(const char *sql, const Params &params);
+
+        /**
+         * Private implementation of the exectuteShared public method.
+         **/
+        std::shared_ptr<const BufferedResult> executeSharedParams(const char *sql, const Params &params);
 
         Connection(const Connection&) = delete;
         Connection(const Connection&&) = delete;
@@ -56,5 +56,21 @@ namespace db {
       }
     };
 
+    /**
+     * Exception thrown when a command does not complete in time (see
+     * Connection::timeout()).
+     **/
+    class TimeoutException : public ExecutionException {
+    public:
+      /**
+       * Constructor.
+       *
+       * @param what - The error message.
+       **/
+      TimeoutException(const std::string &what)
+      : ExecutionException(what) {
+      }
+    };
+
   } // namespace postgres
 }   // namespace db
@@ -0,0 +1,171 @@
+/**
+ * Copyright (c) 2016 Philippe FERDINAND
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ **/
+#pragma once
+
+#include "postgres-connection.h"
+
+#include <cstdio>
+#include <vector>
+
+namespace db {
+  namespace postgres {
+
+    /**
+     * A stream over a large object.
+     *
+     * Large objects can only be used within a transaction. Reads and writes
+     * go through an internal buffer, so that many small reads or writes cost
+     * only a few round trips to the server. Reads larger than the buffer are
+     * copied directly into the caller's buffer.
+     *
+     * ```
+     * cnx.begin();
+     * Oid oid = LargeObject::create(cnx);
+     * LargeObject blob(cnx, oid);
+     * blob.write(data, size);
+     * blob.close();
+     * cnx.commit();
+     * ```
+     *
+     * The connection can not execute other commands while the large object
+     * is open.
+     **/
+    class LargeObject {
+    public:
+
+      /**
+       * Modes of opening a large object.
+       **/
+      enum Mode {
+        READ = 0x40000,           /**< INV_READ **/
+        WRITE = 0x20000,          /**< INV_WRITE **/
+        READ_WRITE = 0x60000      /**< INV_READ | INV_WRITE **/
+      };
+
+      /**
+       * Create a new large object.
+       *
+       * @param conn The connection.
+       * @param oid  The OID of the new large object, or 0 to let the server
+       *             assign an unused OID.
+       * @return The OID of the large object.
+       **/
+      static Oid create(Connection &conn, Oid oid = 0);
+
+      /**
+       * Delete a large object.
+       **/
+      static void unlink(Connection &conn, Oid oid);
+
+      /**
+       * Open a large object.
+       *
+       * @param conn       The connection.
+       * @param oid        The OID of the large object.
+       * @param mode       READ, WRITE or READ_WRITE.
+       * @param bufferSize Size of the internal buffer.
+       **/
+      LargeObject(Connection &conn, Oid oid, Mode mode = READ_WRITE, size_t bufferSize = 1 << 20);
+
+      /**
+       * Destructor.
+       *
+       * Pending writes are flushed and the large object is closed, unless
+       * close() has already been called. Errors are ignored: call close()
+       * to get them.
+       **/
+      ~LargeObject();
+
+      /**
+       * Read from the large object.
+       *
+       * @param buf  The buffer receiving the data.
+       * @param size Number of bytes to read.
+       * @return The number of bytes read, less than `size` only at the end of
+       *         the large object.
+       **/
+      size_t read(char *buf, size_t size);
+
+      /**
+       * Write to the large object.
+       *
+       * @param buf  The data to write.
+       * @param size Number of bytes to write.
+       **/
+      void write(const char *buf, size_t size);
+
+      /**
+       * Move the current position.
+       *
+       * @param offset The new position relative to `whence`.
+       * @param whence SEEK_SET, SEEK_CUR or SEEK_END.
+       * @return The new position.
+       **/
+      int64_t seek(int64_t offset, int whence = SEEK_SET);
+
+      /**
+       * Current position.
+       **/
+      int64_t tell();
+
+      /**
+       * Truncate or extend the large object.
+       *
+       * @param size The new size of the large object.
+       **/
+      void truncate(int64_t size);
+
+      /**
+       * Send the pending writes to the server.
+       **/
+      void flush();
+
+      /**
+       * Flush the pending writes and close the large object.
+       **/
+      void close();
+
+      /**
+       * OID of the large object.
+       **/
+      Oid oid() const noexcept {
+        return oid_;
+      }
+
+    private:
+      Connection       &conn_;
+      Oid               oid_;
+      int               fd_;      /**< Large object descriptor, -1 once closed. **/
+      std::vector<char> buffer_;
+      size_t            begin_;   /**< Start of the unread data or of the pending writes. **/
+      size_t            end_;     /**< End of the unread data or of the pending writes. **/
+      bool              writing_; /**< `true` if the buffer holds pending writes. **/
+
+      void discard();
+      void check(int64_t result);
+
+      LargeObject(const LargeObject&) = delete;
+      LargeObject& operator = (const LargeObject&) = delete;
+    };
+
+  } // namespace postgres
+}   // namespace db
@@ -22,13 +22,20 @@
 #pragma once
 
 #include "postgres-types.h"
+#include "postgres-catalog.h"
 
+#include <cstring>
+#include <iterator>
 #include <string>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 namespace db {
   namespace postgres {
 
+    class Connection;
+
     /**
      * A private class to bind SQL command parameters.
      **/
@@ -42,34 +49,252 @@ namespace db {
       std::vector<int>      lengths_;
       std::vector<int>      formats_;
       std::vector<char *>   buffers_;
-      const struct Settings &settings_;
+      Connection           &conn_;
 
-      Params(const Settings &settings, int size);
+      Params(Connection &conn, int size);
       ~Params();
 
       char *bind(Oid type, size_t length);
 
+      /**
+       * A buffer released with the parameters.
+       **/
+      char *buffer(size_t length);
+
+      /**
+       * Convert the parameters to the types of a prepared statement.
+       *
+       * The parameters are sent without their type when executing a prepared
+       * statement, so that they must be encoded in the exact binary format
+       * expected by the server: integers are widened or narrowed, strings are
+       * parsed client side for dates and timestamps, and sent in text format
+       * for the other types.
+       *
+       * @param targets The types of the parameters of the statement.
+       * @throw ExecutionException if a parameter cannot be converted.
+       **/
+      void convert(const std::vector<Oid> &targets);
+
+      /**
+       * Replace a parameter with a value of another type.
+       **/
+      template<typename T>
+      void replace(size_t index, Oid type, const T &value);
+
+      /**
+       * Send a parameter in text format.
+       **/
+      void replaceText(size_t index, Oid type, const char *text, size_t length);
+
+      /**
+       * The SQL command and the encoded parameters, identifying a query in
+       * the given scope.
+       **/
+      std::string key(const std::string &scope, const char *sql) const;
+
+      /**
+       * Settings::emptyStringAsNull of the connection.
+       **/
+      bool emptyStringAsNull() const noexcept;
+
+      /**
+       * Type of the connection catalog (see Connection::type()).
+       **/
+      const TypeInfo &type(const char *name);
+
+      /**
+       * OID of a type, resolved by name when it is not known statically.
+       **/
+      template<typename T>
+      Oid oid(std::false_type) {
+        return type_traits<T>::oid;
+      }
+
+      template<typename T>
+      Oid oid(std::true_type) {
+        return type(type_traits<T>::name()).oid;
+      }
+
       void bind() const {}
       void bind(std::nullptr_t);
+      void bind(const char *sz);
       void bind(const std::string &s);
       void bind(const std::vector<uint8_t> &bytes);
+      void bind(const bytea_view &bytes);
+#ifdef LIBPQMXX_STRING_VIEW
+      // Inline: the library itself may be compiled before C++17.
+      void bind(std::string_view s) {
+        if (s.length() == 0 && emptyStringAsNull()) {
+          bind(nullptr);
+        }
+        else {
+          bind(VARCHAROID, const_cast<char *>(s.data()), s.length());
+        }
+      }
+#endif
 
-      template<typename T>
-      void bind(T v);
+      /**
+       * Any type supported by type_traits. C strings, including non-const
+       * `char *` and `char[N]`, go to bind(const char *).
+       **/
+      template<typename T,
+               typename = typename std::enable_if<!internal::is_c_string<T>::value>::type>
+      void bind(const T &value) {
+        Oid type = oid<T>(std::integral_constant<bool, type_traits<T>::oid == 0>());
+        char *buf = bind(type, size_t(type_traits<T>::length(value)));
+        type_traits<T>::write(value, buf);
+      }
 
       void bind(Oid type, char *value, size_t length);
 
-      template <typename T>
-      T *bind(Oid type, size_t length);
-
       /**
        * Arrays
        **/
       template<typename T>
-      void bind(const std::vector<array_item<T>> &array);
+      void bind(const std::vector<array_item<T>> &array) {
+        std::pair<Oid, Oid> types = arrayTypes<T>();
+        bind(types.first, types.second, array);
+      }
 
       template<typename T>
-      void bind(Oid type, Oid elemType, const std::vector<array_item<T>> &array);
+      void bind(const std::vector<T> &values) {
+        bind(make_array(values.begin(), values.end()));
+      }
+
+#ifdef LIBPQMXX_SPAN
+      template<typename T, size_t N>
+      void bind(std::span<T, N> values) {
+        bind(make_array(values.begin(), values.end()));
+      }
+#endif
+
+      template<typename Iterator>
+      void bind(const array_range<Iterator> &range) {
+        typedef typename std::iterator_traits<Iterator>::value_type T;
+        std::pair<Oid, Oid> types = arrayTypes<T>();
+        encodeArray<T>(types.first, types.second, range.first, range.last,
+                       internal::is_fixed_width<T>());
+      }
+
+      /**
+       * OIDs of the array type and of the element type.
+       **/
+      template<typename T>
+      std::pair<Oid, Oid> arrayTypes() {
+        static_assert(type_traits<T>::arrayOid != 0 || type_traits<T>::oid == 0,
+                      "arrays of this type are not supported");
+        return arrayTypes<T>(std::integral_constant<bool, type_traits<T>::oid == 0>());
+      }
+
+      template<typename T>
+      std::pair<Oid, Oid> arrayTypes(std::false_type) {
+        return std::make_pair(Oid(type_traits<T>::arrayOid), Oid(type_traits<T>::oid));
+      }
+
+      template<typename T>
+      std::pair<Oid, Oid> arrayTypes(std::true_type) {
+        const TypeInfo &info = type(type_traits<T>::name());
+        if (info.arrayOid == 0) {
+          throw ExecutionException("Type " + info.name + " has no array type");
+        }
+        return std::make_pair(info.arrayOid, info.oid);
+      }
+
+      /**
+       * Header of a one dimension array.
+       **/
+      char *arrayHeader(Oid arrayType, Oid elemType, size_t size, size_t bufferSize) {
+        char *buf = bind(arrayType, bufferSize);
+        buf = write(int32_t(1), buf);        /* Number of dimensions */
+        buf = write(int32_t(0), buf);        /* ignored */
+        buf = write(int32_t(elemType), buf); /* type of elements in the array */
+        buf = write(int32_t(size), buf);     /* Number of elements */
+        return write(int32_t(1), buf);       /* Index of first element */
+      }
+
+      /**
+       * Fixed width numbers: the size of the array is known up front and the
+       * values are byte-swapped inline, in a loop the compiler can vectorize.
+       **/
+      template<typename T, typename Iterator>
+      void encodeArray(Oid arrayType, Oid elemType, Iterator first, Iterator last, std::true_type) {
+        typedef typename internal::is_fixed_width<T>::bits_type bits_type;
+        size_t size = size_t(std::distance(first, last));
+        char *buf = arrayHeader(arrayType, elemType, size,
+                                5 * sizeof(int32_t) + size * (sizeof(int32_t) + sizeof(T)));
+        for (; first != last; ++first) {
+          T value = *first;
+          bits_type bits;
+          std::memcpy(&bits, &value, sizeof(T));
+          buf = internal::store_big_endian(uint32_t(sizeof(T)), buf);
+          buf = internal::store_big_endian(bits, buf);
+        }
+      }
+
+      /**
+       * Other types: the values are encoded through their type_traits.
+       **/
+      template<typename T, typename Iterator>
+      void encodeArray(Oid arrayType, Oid elemType, Iterator first, Iterator last, std::false_type) {
+        bool emptyAsNull = elemType == VARCHAROID && emptyStringAsNull();
+        size_t size = 0;
+        size_t bufferSize = 5 * sizeof(int32_t); // array headers
+        for (Iterator i = first; i != last; ++i, ++size) {
+          bufferSize += sizeof(int32_t) + type_traits<T>::length(*i);
+        }
+
+        char *buf = arrayHeader(arrayType, elemType, size, bufferSize);
+        for (; first != last; ++first) {
+          int32_t length = type_traits<T>::length(*first);
+          if (emptyAsNull && length == 0) {
+            buf = write(int32_t(-1), buf);
+          }
+          else {
+            buf = write(length, buf);
+            buf = type_traits<T>::write(*first, buf);
+          }
+        }
+      }
+
+      template<typename T>
+      void bind(Oid arrayType, Oid elemType, const std::vector<array_item<T>> &array) {
+
+        // The value of the array should look like this:
+        //
+        // struct pg_array {
+        //   int32_t ndim; /* Number of dimensions */
+        //   int32_t ign;  /* offset for data, removed by libpq */
+        //   Oid elemtype; /* type of element in the array */
+        //
+        //   /* First dimension */
+        //   int32_t size;  /* Number of elements */
+        //   int32_t index; /* Index of first element */
+        //   T first_value; /* Beginning of the data */
+        // }
+
+        int32_t bufferSize = 5 * sizeof(int32_t); // array headers
+        for (auto &i: array) {
+          bufferSize += sizeof(int32_t);
+          if (!i.isNull) {
+            bufferSize += type_traits<T>::length(i.value);
+          }
+        }
+
+        char *buf = arrayHeader(arrayType, elemType, array.size(), bufferSize);
+        for (auto &i: array) {
+          int32_t length = i.isNull ? -1 : type_traits<T>::length(i.value);
+          if (length == -1
+              || (elemType == VARCHAROID
+                  && emptyStringAsNull()
+                  && length == 0)) {
+            buf = write(int32_t(-1), buf);
+          }
+          else {
+            buf = write(length, buf);
+            buf = type_traits<T>::write(i.value, buf);
+          }
+        }
+      }
     };
 
   } // namespace postgres
@@ -22,12 +22,187 @@
 #pragma once
 
 #include "postgres-types.h"
+#include "postgres-thread-pool.h"
+
+#include <algorithm>
+#include <cassert>
+#include <memory>
+#include <string>
+#include <vector>
 
 namespace db {
   namespace postgres {
     
     class Connection;
     class Result;
+    class BufferedResult;
+    class Prefetcher;
+
+    /**
+     * Column names and types shared by the snapshots of a result.
+     **/
+    struct RowDescriptor {
+      std::vector<std::string> names;  /**< Column names. **/
+      std::vector<Oid>         types;  /**< Column types. **/
+      std::vector<int>         formats; /**< Column formats (0 text, 1 binary). **/
+    };
+
+    /**
+     * An owned copy of a row.
+     *
+     * A Row is only valid until the next row is fetched. A snapshot taken
+     * with Row::snapshot() keeps the row as received from the server, in a
+     * single allocation holding the lengths and the values of the columns,
+     * and can be decoded later, possibly on another thread, with the same
+     * methods as Row. The column names and types are shared by all the
+     * snapshots taken from the same result.
+     *
+     * ```
+     * std::vector<RowSnapshot> rows;
+     * for (auto &row: cnx.execute("SELECT emp_no, firstname FROM employees")) {
+     *   rows.push_back(row.snapshot());
+     * }
+     * std::string name = rows[0].as<std::string>(1);
+     * ```
+     **/
+    class RowSnapshot {
+
+      friend class Row;
+
+    public:
+
+      RowSnapshot() = default;
+      RowSnapshot(RowSnapshot &&other) = default;
+      RowSnapshot &operator = (RowSnapshot &&other) = default;
+
+      /**
+       * Number of columns.
+       **/
+      int columns() const noexcept {
+        return descriptor_ ? int(descriptor_->types.size()) : 0;
+      }
+
+      /**
+       * Test a column for a null value.
+       *
+       * @see Row::isNull()
+       **/
+      bool isNull(int column) const {
+        return length(column) == -1;
+      }
+
+      /**
+       * Get a column value.
+       *
+       * @see Row::as()
+       **/
+      template<typename T>
+      T as(int column) const {
+        assert(type_traits<T>::accepts(type(column)) && "Unexpected C++ type for the column");
+        if (isNull(column)) {
+          return type_traits<T>::null();
+        }
+        if (isText(column)) {
+          return internal::text_reader<T>::read(value(column), length(column));
+        }
+        return type_traits<T>::read(value(column), length(column));
+      }
+
+      /**
+       * Get a column values for arrays.
+       *
+       * @see Row::asArray()
+       **/
+      template<typename T>
+      std::vector<array_item<T>> asArray(int column) const {
+        std::vector<array_item<T>> array;
+        intoArray(column, array);
+        return array;
+      }
+
+      /**
+       * Read a column into an existing value.
+       *
+       * @see Row::into()
+       **/
+      template<typename T>
+      bool into(int column, T &value) const {
+        assert(type_traits<T>::accepts(type(column)) && "Unexpected C++ type for the column");
+        if (isNull(column)) {
+          internal::read_null(value);
+          return false;
+        }
+        if (isText(column)) {
+          internal::read_text_into(this->value(column), length(column), value);
+        }
+        else {
+          internal::read_into(this->value(column), length(column), value);
+        }
+        return true;
+      }
+
+      /**
+       * Read an array column into an existing vector.
+       *
+       * @see Row::intoArray()
+       **/
+      template<typename T>
+      size_t intoArray(int column, std::vector<T> &array) const {
+        if (isText(column)) {
+          throw ExecutionException("Arrays cannot be read from a result in text format.");
+        }
+        return internal::read_array(isNull(column) ? nullptr : value(column), array);
+      }
+
+      /**
+       * Get a column name.
+       *
+       * @see Row::columnName()
+       **/
+      const char *columnName(int column) const {
+        assert(column >= 0 && column < columns());
+        return descriptor_->names[column].c_str();
+      }
+
+      /**
+       * Get the row number.
+       *
+       * @see Row::num()
+       **/
+      int num() const noexcept {
+        return num_;
+      }
+
+    private:
+      std::shared_ptr<const RowDescriptor> descriptor_;
+      std::unique_ptr<char[]> data_;  /**< Lengths, offsets then values. **/
+      int num_ = 0;
+
+      // Layout of data_: the lengths of the columns (-1 for null) as int32_t,
+      // the offsets of the values as uint32_t and the values, each one
+      // followed by a '\0' like in a PGresult.
+      int32_t length(int column) const {
+        assert(column >= 0 && column < columns());
+        return reinterpret_cast<const int32_t *>(data_.get())[column];
+      }
+
+      const char *value(int column) const {
+        const uint32_t *offsets = reinterpret_cast<const uint32_t *>(data_.get()) + columns();
+        return data_.get() + offsets[column];
+      }
+
+      Oid type(int column) const {
+        assert(column >= 0 && column < columns());
+        return descriptor_->types[column];
+      }
+
+      bool isText(int column) const {
+        return descriptor_->formats[column] == 0;
+      }
+
+      RowSnapshot(const RowSnapshot&) = delete;
+      RowSnapshot& operator = (const RowSnapshot&) = delete;
+    };
 
     /**
      * A row in a Result.
@@ -38,6 +213,7 @@ namespace db {
     class Row {
 
       friend class Result;
+      friend class BufferedResult;
 
     public:
 
@@ -87,6 +263,17 @@ namespace db {
        * will be returned. To insure the column value is really null the method
        * isNull() should be used.
        *
+       * Character types can also be read without copy as `const char *` (null
+       * value is `nullptr`) or `std::string_view` when compiling in C++17. The
+       * value is then only valid until the next row is fetched.
+       *
+       * Other types can be supported by specializing type_traits.
+       *
+       * The results of multiple commands executed at once are received in
+       * text format: only numbers, booleans, character strings, `bytea`,
+       * dates and timestamps can then be read, other types throw an
+       * ExecutionException.
+       *
        * @param column Column number. Column numbers start at 0.
        * @return The value of the column.
        *
@@ -96,7 +283,19 @@ namespace db {
        *            in non debug modes is undertermined.
        **/
       template<typename T>
-      T as(int column) const;
+      T as(int column) const {
+        assert(pgresult_ != nullptr);
+        assert(type_traits<T>::accepts(PQftype(pgresult_, column)) && "Unexpected C++ type for the column");
+        if (PQgetisnull(pgresult_, row_, column)) {
+          return type_traits<T>::null();
+        }
+        if (PQfformat(pgresult_, column) == 0) {
+          return internal::text_reader<T>::read(PQgetvalue(pgresult_, row_, column),
+                                                PQgetlength(pgresult_, row_, column));
+        }
+        return type_traits<T>::read(PQgetvalue(pgresult_, row_, column),
+                                    PQgetlength(pgresult_, row_, column));
+      }
 
       /**
        * Get a column values for arrays.
@@ -108,8 +307,7 @@ namespace db {
 
        *
        * Usage is the similar to using `T as(int column)` and binding between
-       * SQL names and C++ types are the same. Only bytea is not
-       * supported.
+       * SQL names and C++ types are the same.
        *
        * Only array of one dimention are supported.
        *
@@ -119,7 +317,71 @@ namespace db {
        *         `isNull`).
        **/
       template<typename T>
-      std::vector<array_item<T>> asArray(int column) const;
+      std::vector<array_item<T>> asArray(int column) const {
+        std::vector<array_item<T>> array;
+        intoArray(column, array);
+        return array;
+      }
+
+      /**
+       * Read a column into an existing value.
+       *
+       * Unlike as(), the memory already allocated by `value` is reused
+       * when possible: strings, `bytea` vectors and text_array keep their
+       * capacity from one row to the next.
+       *
+       * ```
+       * std::string name;
+       * for (auto &row: cnx.execute("SELECT name FROM employees")) {
+       *   row.into(0, name);
+       * }
+       * ```
+       *
+       * @param column Column number. Column numbers start at 0.
+       * @param value  The value receiving the column.
+       * @return `false` if the column is null, in which case `value` is
+       *         set to the null value of its type (see as()).
+       **/
+      template<typename T>
+      bool into(int column, T &value) const {
+        assert(pgresult_ != nullptr);
+        assert(type_traits<T>::accepts(PQftype(pgresult_, column)) && "Unexpected C++ type for the column");
+        if (PQgetisnull(pgresult_, row_, column)) {
+          internal::read_null(value);
+          return false;
+        }
+        if (PQfformat(pgresult_, column) == 0) {
+          internal::read_text_into(PQgetvalue(pgresult_, row_, column),
+                                   PQgetlength(pgresult_, row_, column), value);
+        }
+        else {
+          internal::read_into(PQgetvalue(pgresult_, row_, column),
+                              PQgetlength(pgresult_, row_, column), value);
+        }
+        return true;
+      }
+
+      /**
+       * Read an array column into an existing vector.
+       *
+       * The vector is resized to the number of elements and its elements
+       * are read like into(), reusing their memory. A null array gives an
+       * empty vector.
+       *
+       * @param column Column number. Column numbers start at 0.
+       * @param array  The vector receiving the elements: either a vector of
+       *               T, where null elements are set to the null value of
+       *               T, or a vector of array_item<T>.
+       * @return The number of elements.
+       **/
+      template<typename T>
+      size_t intoArray(int column, std::vector<T> &array) const {
+        assert(pgresult_ != nullptr);
+        if (PQfformat(pgresult_, column) == 0) {
+          throw ExecutionException("Arrays cannot be read from a result in text format.");
+        }
+        return internal::read_array(PQgetisnull(pgresult_, row_, column) ? nullptr : PQgetvalue(pgresult_, row_, column), array);
+      }
 
       /**
        * Get a column name.
@@ -145,6 +407,14 @@ namespace db {
        **/
       int num() const noexcept;
 
+      /**
+       * Copy the row.
+       *
+       * @return An owned copy of the row, still valid once the next row is
+       *         fetched.
+       **/
+      RowSnapshot snapshot() const;
+
       /**
        * Get a column value.
        *
@@ -156,12 +426,23 @@ namespace db {
       }
 
     private:
-      Result &result_;  /**< The result set by the constructor **/
+      PGresult *pgresult_;  /**< Native result holding the row. **/
+      int row_;             /**< Row number in the native result. **/
+      int num_;             /**< Row number in the whole result. **/
+
+      /**
+       * Columns shared by the snapshots, built by the first snapshot().
+       **/
+      mutable std::shared_ptr<const RowDescriptor> descriptor_;
 
       /**
        * Constructor.
+       *
+       * @param pgresult The native result holding the row.
+       * @param row      Row number in `pgresult`.
+       * @param num      Row number in the whole result (see num()).
        **/
-      Row(Result &result);
+      Row(PGresult *pgresult = nullptr, int row = 0, int num = 0);
 
       Row(const Row&) = delete;
       Row& operator = (const Row&) = delete;
@@ -198,6 +479,33 @@ namespace db {
        * @return The number of rows affected by the SQL statement.
        **/
       uint64_t count() const noexcept;
+
+      /**
+       * Prefetch the rows on a background thread.
+       *
+       * By default, rows are received from the server when the iterator moves
+       * to the next row, so the processing of the rows and the network are
+       * never overlapping. Once prefetch() has been called, a background
+       * thread receives the next rows in batches while the current ones are
+       * processed. This is useful for long scans where the processing of
+       * each row is significant.
+       *
+       * ```
+       *  for (auto &row: cnx.execute("SELECT ...").prefetch()) {
+       *    ...
+       *  }
+       * ```
+       *
+       * The connection must not be used by another thread until all the rows
+       * have been fetched or the result is cleared by the next call to
+       * execute().
+       *
+       * @param batchSize Maximum number of rows in a batch.
+       * @param batches   Maximum number of batches received ahead of the
+       *                  processing.
+       * @return The result itself.
+       **/
+      Result &prefetch(int batchSize = 256, int batches = 4);
       
       /**
        * Support of the range-based for loops.
@@ -214,13 +522,13 @@ namespace db {
       class iterator {
       public:
 
-        iterator(Row *ptr): ptr_(ptr) {} /**< Constructor. **/
-        iterator operator ++();          /**< Next row in the resultset **/
+        iterator(Result *ptr): ptr_(ptr) {} /**< Constructor. **/
+        iterator operator ++();             /**< Next row in the resultset **/
         bool operator != (const iterator &other) { return ptr_ != other.ptr_; }
         Row &operator *() { return *ptr_; }
 
       private:
-        Row *ptr_;
+        Result *ptr_; /**< The result, or nullptr past the end. **/
       };
 
       /**
@@ -239,13 +547,12 @@ namespace db {
 
     private:
 
-      PGresult *pgresult_;  /**< Native result **/
       Connection &conn_;    /**< Connection owning the result. **/
-      Row begin_, end_;     /**< Virtual begin and end of the result. **/
-      int num_;             /**< Current row number. */
 
       ExecStatusType status_ = PGRES_EMPTY_QUERY;
 
+      std::unique_ptr<Prefetcher> prefetcher_; /**< Set by prefetch(). **/
+
       Result(Connection &conn);
       ~Result();
 
@@ -271,11 +578,142 @@ namespace db {
        **/
       void clear();
 
+      /**
+       * Discard the rows already received, without waiting for the server.
+       *
+       * @return true if the last row of the query has been received.
+       **/
+      bool discardReceived() noexcept;
+
+      /**
+       * Stop the background thread started by prefetch().
+       **/
+      void stopPrefetch() noexcept;
+
       Result(const Result&) = delete;
       Result(const Result&&) = delete;
       Result& operator = (const Result&) = delete;
       Result& operator = (const Result&&) = delete;
     };
     
+    /**
+     * A result fully loaded in memory.
+     *
+     * Unlike Result, where rows are fetched one by one from the server, all the
+     * rows of a BufferedResult are available at once and can be decoded in
+     * parallel using decode().
+     *
+     * ```
+     * ThreadPool pool(32);
+     * auto result = cnx.executeBuffered("SELECT id, created_at FROM events");
+     * std::vector<int32_t> ids(result.size());
+     * std::vector<timestamptz_t> created(result.size());
+     * result.decode(pool, ids.data(), created.data());
+     * ```
+     **/
+    class BufferedResult {
+
+      friend class Connection;
+
+    public:
+
+      /**
+       * Move constructor.
+       **/
+      BufferedResult(BufferedResult &&other) noexcept;
+
+      /**
+       * Destructor.
+       **/
+      ~BufferedResult();
+
+      /**
+       * Number of rows in the result.
+       **/
+      int size() const noexcept;
+
+      /**
+       * Number of columns in the result.
+       **/
+      int columns() const noexcept;
+
+      /**
+       * Number of rows affected by the SQL command.
+       *
+       * @see Result::count()
+       **/
+      uint64_t count() const noexcept;
+
+      /**
+       * Decode all the rows of the result into column buffers.
+       *
+       * The rows are split into ranges decoded concurrently on the given
+       * thread pool. Each buffer receives the values of one column, in the
+       * order of the columns of the result, and must be large enough to hold
+       * size() values. The C++ type of a buffer follows the same rules as
+       * Row::as(). A `nullptr` buffer, typed or not, skips the column, and a
+       * buffer of `array_item<T>` can be used to keep track of null values.
+       *
+       * @param pool    The threads used to decode the result.
+       * @param buffers One buffer per column.
+       **/
+      template<typename... T>
+      void decode(ThreadPool &pool, T... buffers) const {
+        assert(int(sizeof...(T)) <= columns());
+        const int rows = size();
+        const int chunk = 1024; // rows per task
+        pool.run(size_t((rows + chunk - 1) / chunk), [&](size_t task) {
+          int first = int(task) * chunk;
+          int last = std::min(first + chunk, rows);
+          int column = 0;
+          int expand[] = { 0, (decode(column++, first, last, buffers), 0)... };
+          (void)expand;
+        });
+      }
+
+    private:
+      PGresult *pgresult_;  /**< Native result **/
+
+      /**
+       * Constructor.
+       *
+       * @param pgresult The native result, owned by the BufferedResult.
+       **/
+      BufferedResult(PGresult *pgresult);
+
+      /**
+       * Decode a range of rows of one column.
+       **/
+      void decode(int, int, int, std::nullptr_t) const {}
+
+      template<typename T>
+      void decode(int column, int first, int last, T *buffer) const {
+        if (buffer) {
+          for (int i = first; i < last; i++) {
+            buffer[i] = Row(pgresult_, i, i + 1).as<T>(column);
+          }
+        }
+      }
+
+      template<typename T>
+      void decode(int column, int first, int last, array_item<T> *buffer) const {
+        if (buffer) {
+          for (int i = first; i < last; i++) {
+            Row row(pgresult_, i, i + 1);
+            if (row.isNull(column)) {
+              buffer[i] = array_item<T>(nullptr);
+            }
+            else {
+              buffer[i] = array_item<T>(row.as<T>(column));
+            }
+          }
+        }
+      }
+
+      BufferedResult(const BufferedResult&) = delete;
+      BufferedResult& operator = (const BufferedResult&) = delete;
+      BufferedResult& operator = (const BufferedResult&&) = delete;
+    };
+
   } // namespace postgres
 }   // namespace db
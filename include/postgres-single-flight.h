@@ -0,0 +1,93 @@
+/**
+ * Copyright (c) 2016 Philippe FERDINAND
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ **/
+#pragma once
+
+#include "postgres-result.h"
+
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace db {
+  namespace postgres {
+
+    /**
+     * Share the execution of identical queries running at the same time.
+     *
+     * When many threads execute the same query with the same parameters at
+     * the same time, for instance when a cached value expires, only the
+     * first one actually executes the query. The others wait for its result
+     * and all of them receive the same immutable result. A query executed
+     * once the previous identical one has completed is executed again: the
+     * results are shared, not cached.
+     *
+     * The queries are shared by the connections using the same SingleFlight
+     * in their settings and executing them with Connection::executeShared().
+     *
+     * ```
+     * Settings settings;
+     * settings.flights = std::make_shared<SingleFlight>();
+     *
+     * // On each thread
+     * Connection cnx(settings);
+     * cnx.connect();
+     * auto result = cnx.executeShared("SELECT * FROM products WHERE category = $1", category);
+     * ```
+     **/
+    class SingleFlight {
+
+      friend class Connection;
+
+    public:
+
+      SingleFlight() = default;
+
+      /**
+       * Number of queries in progress.
+       **/
+      size_t size() const;
+
+    private:
+      typedef std::shared_ptr<const BufferedResult> result_type;
+
+      mutable std::mutex mutex_;
+      std::unordered_map<std::string, std::shared_future<result_type>> flights_;
+
+      /**
+       * Execute a query unless an identical one is in progress.
+       *
+       * @param key   The SQL command and its encoded parameters.
+       * @param query The function executing the query.
+       * @return The result of the query in progress or of `query`.
+       * @throw The exception thrown by the query in progress or by `query`.
+       **/
+      result_type execute(const std::string &key, const std::function<result_type()> &query);
+
+      SingleFlight(const SingleFlight&) = delete;
+      SingleFlight& operator = (const SingleFlight&) = delete;
+    };
+
+  } // namespace postgres
+}   // namespace db
@@ -0,0 +1,106 @@
+/**
+ * Copyright (c) 2016 Philippe FERDINAND
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ **/
+#pragma once
+
+#include "postgres-types.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace db {
+  namespace postgres {
+
+    /**
+     * A statement declared in a StatementRegistry.
+     **/
+    struct Statement {
+      std::string      name;  /**< Name of the prepared statement. **/
+      std::string      sql;   /**< A single SQL command. **/
+      std::vector<Oid> types; /**< Types of the parameters, 0 to let the server infer them. **/
+    };
+
+    /**
+     * The statements prepared by all the connections.
+     *
+     * The statements of the registry are prepared by each connection sharing
+     * the registry in Settings::statements as soon as it is opened, in a
+     * single round trip. They can then be executed by name with
+     * Connection::executePrepared() on any of those connections, without
+     * paying the parse and plan latency on the first execution. Statements
+     * added once a connection is opened are prepared on their first
+     * execution.
+     *
+     * ```
+     * Settings settings;
+     * settings.statements = std::make_shared<StatementRegistry>();
+     * settings.statements->add("employee", "SELECT * FROM employees WHERE emp_no = $1", { INT4OID });
+     *
+     * Connection cnx(settings);
+     * cnx.connect();
+     * cnx.executePrepared("employee", 10001);
+     * ```
+     **/
+    class StatementRegistry {
+    public:
+
+      StatementRegistry() = default;
+
+      /**
+       * Declare a statement.
+       *
+       * @param name  The name of the statement.
+       * @param sql   A single SQL command.
+       * @param types The types of the parameters. Missing types and types
+       *              set to 0 are inferred by the server.
+       * @return The registry itself.
+       * @throw ExecutionException if another statement has the same name.
+       **/
+      StatementRegistry &add(const std::string &name, const std::string &sql,
+                             const std::vector<Oid> &types = std::vector<Oid>());
+
+      /**
+       * Find a statement.
+       *
+       * @param name The name of the statement.
+       * @return The statement or nullptr if it is not in the registry.
+       **/
+      std::shared_ptr<const Statement> find(const std::string &name) const;
+
+      /**
+       * All the statements, in the order they have been added.
+       **/
+      std::vector<std::shared_ptr<const Statement>> statements() const;
+
+    private:
+      mutable std::mutex mutex_;
+      std::vector<std::shared_ptr<const Statement>> statements_;
+      std::unordered_map<std::string, std::shared_ptr<const Statement>> names_;
+
+      StatementRegistry(const StatementRegistry&) = delete;
+      StatementRegistry& operator = (const StatementRegistry&) = delete;
+    };
+
+  } // namespace postgres
+}   // namespace db
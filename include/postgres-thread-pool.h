@@ -0,0 +1,134 @@
+/**
+ * Copyright (c) 2016 Philippe FERDINAND
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ **/
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace db {
+  namespace postgres {
+
+    /**
+     * A work-stealing pool of threads.
+     *
+     * The pool runs one job at a time. A job is made of `count` independent
+     * tasks identified by their index. Tasks are spread over per-thread
+     * queues; a thread running out of tasks steals from the others, so that
+     * uneven tasks (rows with large arrays or numerics) keep all the threads
+     * busy until the end of the job.
+     *
+     * ```
+     * ThreadPool pool(8);
+     * pool.run(100, [&](size_t task) {
+     *   ...
+     * });
+     * ```
+     **/
+    class ThreadPool {
+    public:
+
+      /**
+       * Constructor.
+       *
+       * @param threads Number of worker threads. The thread calling run() is
+       *        also taking part in the job, so a pool of 0 thread is valid
+       *        and will run all the tasks on the calling thread.
+       **/
+      explicit ThreadPool(unsigned threads = std::thread::hardware_concurrency());
+
+      /**
+       * Destructor.
+       *
+       * Wait for the worker threads to terminate.
+       **/
+      ~ThreadPool();
+
+      /**
+       * Number of worker threads.
+       **/
+      size_t size() const noexcept {
+        return threads_.size();
+      }
+
+      /**
+       * Run a job and wait for all its tasks to complete.
+       *
+       * If a task throws an exception, the remaining tasks are still executed
+       * and the first exception is re-thrown by run() once the job is over.
+       *
+       * @param count Number of tasks of the job.
+       * @param task  The function executing one task given its index in
+       *              `[0, count)`.
+       **/
+      void run(size_t count, const std::function<void(size_t)> &task);
+
+    private:
+
+      /**
+       * Tasks queue of a thread.
+       **/
+      struct Queue {
+        std::mutex         mutex;
+        std::deque<size_t> tasks;
+      };
+
+      std::vector<std::thread>            threads_;
+      std::vector<std::unique_ptr<Queue>> queues_;  /**< One per thread + caller. **/
+
+      std::mutex              run_;         /**< Serialize the calls to run(). **/
+      std::mutex              mutex_;       /**< Protect the members below. **/
+      std::condition_variable wakeup_;      /**< Signal a new job or stop. **/
+      std::condition_variable done_;        /**< Signal the end of a job. **/
+      const std::function<void(size_t)> *task_;
+      std::exception_ptr      error_;       /**< First error of the job. **/
+      size_t                  busy_;        /**< Threads still working. **/
+      size_t                  generation_;  /**< Job number. **/
+      bool                    stop_;
+
+      /**
+       * Main loop of a worker thread.
+       **/
+      void loop(size_t index);
+
+      /**
+       * Execute tasks until all the queues are empty.
+       **/
+      void work(size_t index);
+
+      /**
+       * Take a task from the queue `index` or steal one from another queue.
+       **/
+      bool next(size_t index, size_t *task);
+
+      ThreadPool(const ThreadPool&) = delete;
+      ThreadPool& operator = (const ThreadPool&) = delete;
+    };
+
+  } // namespace postgres
+}   // namespace db
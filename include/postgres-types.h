@@ -22,12 +22,32 @@
 #pragma once
 
 #include "libpq-fe.h"
+#include "postgres-exceptions.h"
 
+#include <algorithm>
+#include <cassert>
+#include <chrono>
 #include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
 #include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 #include <vector>
 #include <stdint.h>
 
+#if __cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+  #include <string_view>
+  #define LIBPQMXX_STRING_VIEW 1 /**< std::string_view is available **/
+#endif
+
+#if __cplusplus >= 202002L || (defined(_MSVC_LANG) && _MSVC_LANG >= 202002L)
+  #include <span>
+  #define LIBPQMXX_SPAN 1 /**< std::span is available **/
+#endif
+
 namespace db {
   namespace postgres {
 
@@ -69,6 +89,9 @@ namespace db {
     const Oid MACADDROID = 829;
     const Oid INETOID = 869;
     const Oid CIDROID = 650;
+    const Oid CIDRARRAYOID = 651;
+    const Oid MACADDRARRAYOID = 1040;
+    const Oid INETARRAYOID = 1041;
     const Oid BOOLARRAYOID = 1000;
     const Oid BYTEAARRAYOID = 1001;
     const Oid CHARARRAYOID = 1002;
@@ -118,11 +141,23 @@ namespace db {
     const Oid LSNOID = 3220;
     const Oid TSVECTOROID = 3614;
     const Oid GTSVECTOROID = 3642;
+    const Oid TSVECTORARRAYOID = 3643;
     const Oid TSQUERYOID = 3615;
     const Oid REGCONFIGOID = 3734;
     const Oid REGDICTIONARYOID = 3769;
     const Oid JSONBOID = 3802;
     const Oid INT4RANGEOID = 3904;
+    const Oid INT4RANGEARRAYOID = 3905;
+    const Oid NUMRANGEOID = 3906;
+    const Oid NUMRANGEARRAYOID = 3907;
+    const Oid TSRANGEOID = 3908;
+    const Oid TSRANGEARRAYOID = 3909;
+    const Oid TSTZRANGEOID = 3910;
+    const Oid TSTZRANGEARRAYOID = 3911;
+    const Oid DATERANGEOID = 3912;
+    const Oid DATERANGEARRAYOID = 3913;
+    const Oid INT8RANGEOID = 3926;
+    const Oid INT8RANGEARRAYOID = 3927;
     const Oid RECORDOID = 2249;
     const Oid RECORDARRAYOID = 2287;
     const Oid CSTRINGOID = 2275;
@@ -274,6 +309,441 @@ namespace db {
     typedef std::vector<array_item<timestamptz_t>> array_timestamptz_t; /**< Array of `timestamp with time zone ` values. **/
     typedef std::vector<array_item<interval_t>>    array_interval_t;    /**< Array of `interval` values. **/
 
+    /**
+     * An `inet` value: an IPv4 or IPv6 host address and its netmask.
+     *
+     * The address is kept in its binary form; it is only formatted as text
+     * when str() is called.
+     **/
+    struct inet_t {
+      uint8_t family;      /**< 4 for IPv4, 6 for IPv6. **/
+      uint8_t bits;        /**< Number of bits of the netmask. **/
+      uint8_t address[16]; /**< Address in network byte order (4 bytes for IPv4). **/
+
+      /**
+       * Number of bytes of the address.
+       **/
+      int size() const {
+        return family == 6 ? 16 : 4;
+      }
+
+      /**
+       * Text representation of the address, as formatted by PostgreSQL.
+       **/
+      std::string str() const;
+    };
+
+    /**
+     * A `cidr` value: an IPv4 or IPv6 network.
+     **/
+    struct cidr_t : inet_t {
+      /**
+       * Text representation of the network, as formatted by PostgreSQL.
+       **/
+      std::string str() const;
+    };
+
+    /**
+     * Compare two addresses in the sort order of PostgreSQL: IPv4 before
+     * IPv6, then by network part, netmask length and whole address.
+     *
+     * @return A negative value if `a` is before `b`, 0 if they are equal or
+     *         a positive value if `a` is after `b`.
+     **/
+    int compare(const inet_t &a, const inet_t &b);
+
+    inline bool operator==(const inet_t &a, const inet_t &b) {
+      return a.family == b.family && a.bits == b.bits
+          && std::memcmp(a.address, b.address, size_t(a.size())) == 0;
+    }
+
+    inline bool operator!=(const inet_t &a, const inet_t &b) {
+      return !(a == b);
+    }
+
+    inline bool operator<(const inet_t &a, const inet_t &b) {
+      return compare(a, b) < 0;
+    }
+
+    /**
+     * A `macaddr` value.
+     **/
+    struct macaddr_t {
+      uint8_t address[6]; /**< The 6 bytes of the MAC address. **/
+
+      /**
+       * Text representation of the address (`08:00:2b:01:02:03`).
+       **/
+      std::string str() const;
+    };
+
+    inline bool operator==(const macaddr_t &a, const macaddr_t &b) {
+      return std::memcmp(a.address, b.address, sizeof(a.address)) == 0;
+    }
+
+    inline bool operator!=(const macaddr_t &a, const macaddr_t &b) {
+      return !(a == b);
+    }
+
+    inline bool operator<(const macaddr_t &a, const macaddr_t &b) {
+      return std::memcmp(a.address, b.address, sizeof(a.address)) < 0;
+    }
+
+    typedef std::vector<array_item<inet_t>>        array_inet_t;        /**< Array of `inet` values. **/
+    typedef std::vector<array_item<cidr_t>>        array_cidr_t;        /**< Array of `cidr` values. **/
+    typedef std::vector<array_item<macaddr_t>>     array_macaddr_t;     /**< Array of `macaddr` values. **/
+
+    /**
+     * A view of bytes in the memory of the caller, sent or read as `bytea`
+     * without copy.
+     *
+     * As a parameter, the bytes are sent directly from the caller's memory,
+     * which can be any buffer such as a memory-mapped file. As a result, the
+     * view points into the buffer of the result and is only valid as long as
+     * the row it was read from.
+     *
+     * ```
+     * cnx.execute("INSERT INTO blobs VALUES ($1)", bytea_view(data, size));
+     * ```
+     **/
+    struct bytea_view {
+      const uint8_t *data; /**< First byte. **/
+      size_t         size; /**< Number of bytes. **/
+
+      /**
+       * Constructor.
+       **/
+      bytea_view(const void *d = nullptr, size_t s = 0)
+      : data(static_cast<const uint8_t *>(d)), size(s) {}
+
+      /**
+       * View of the bytes of a vector.
+       **/
+      bytea_view(const std::vector<uint8_t> &bytes)
+      : data(bytes.data()), size(bytes.size()) {}
+
+      const uint8_t *begin() const { return data; }        /**< First byte. **/
+      const uint8_t *end() const { return data + size; }   /**< Past-the-end byte. **/
+    };
+
+    /**
+     * A zero-copy view of an `hstore` value.
+     *
+     * The keys and values are read in place from the buffer of the result,
+     * so the view is only valid as long as the row it was read from. Pairs
+     * are decoded one at a time while iterating.
+     *
+     * ```
+     * hstore_view attributes = row.as<hstore_view>(0);
+     * auto color = attributes.find("color");
+     * if (color != attributes.end() && !color->isNull()) {
+     *   std::string value(color->value, color->valueLength);
+     * }
+     * ```
+     **/
+    class hstore_view {
+    public:
+
+      /**
+       * A key/value pair.
+       **/
+      struct entry {
+        const char *key;         /**< Key (not null terminated). **/
+        int32_t     keyLength;   /**< Number of bytes of the key. **/
+        const char *value;       /**< Value (not null terminated). **/
+        int32_t     valueLength; /**< Number of bytes of the value, -1 if null. **/
+
+        bool isNull() const { return valueLength < 0; } /**< `true` if the value is null. **/
+      };
+
+      class iterator {
+      public:
+
+        iterator(const char *pos, int32_t count); /**< Constructor. **/
+        iterator operator ++();                   /**< Next pair. **/
+        bool operator == (const iterator &other) const { return count_ == other.count_; }
+        bool operator != (const iterator &other) const { return count_ != other.count_; }
+        const entry &operator *() const { return entry_; }
+        const entry *operator ->() const { return &entry_; }
+
+      private:
+        const char *pos_;   /**< Start of the next pair. **/
+        int32_t     count_; /**< Number of pairs left, including the current one. **/
+        entry       entry_; /**< Current pair. **/
+
+        void decode();
+      };
+
+      /**
+       * Constructor of a view over an hstore value in binary format.
+       **/
+      hstore_view(const char *data = nullptr, int32_t length = 0)
+      : data_(data), length_(length) {}
+
+      int32_t size() const;  /**< Number of pairs. **/
+      iterator begin() const; /**< First pair. **/
+      iterator end() const;   /**< Past-the-end pair. **/
+
+      /**
+       * Find a key.
+       *
+       * @return An iterator to the pair or end() if the key is not found.
+       **/
+      iterator find(const char *key, size_t length) const;
+      iterator find(const std::string &key) const {
+        return find(key.data(), key.length());
+      }
+
+      const char *data() const { return data_; }   /**< Binary value. **/
+      int32_t length() const { return length_; }   /**< Number of bytes of the binary value. **/
+
+    private:
+      const char *data_;
+      int32_t     length_;
+    };
+
+    /**
+     * A zero-copy view of a `tsvector` value.
+     *
+     * Like hstore_view, the view is only valid as long as the row it was
+     * read from.
+     **/
+    class tsvector_view {
+    public:
+
+      /**
+       * A lexeme and its positions.
+       **/
+      struct entry {
+        const char *lexeme;     /**< Lexeme (null terminated). **/
+        int32_t     length;     /**< Number of bytes of the lexeme. **/
+        int32_t     positions;  /**< Number of positions. **/
+        const char *data;       /**< Binary positions. **/
+
+        int position(int i) const; /**< Position `i` of the lexeme (starting at 1 in the document). **/
+        char weight(int i) const;  /**< Weight (`A` to `D`) of position `i`. **/
+      };
+
+      class iterator {
+      public:
+
+        iterator(const char *pos, int32_t count); /**< Constructor. **/
+        iterator operator ++();                   /**< Next lexeme. **/
+        bool operator == (const iterator &other) const { return count_ == other.count_; }
+        bool operator != (const iterator &other) const { return count_ != other.count_; }
+        const entry &operator *() const { return entry_; }
+        const entry *operator ->() const { return &entry_; }
+
+      private:
+        const char *pos_;   /**< Start of the next lexeme. **/
+        int32_t     count_; /**< Number of lexemes left, including the current one. **/
+        entry       entry_; /**< Current lexeme. **/
+
+        void decode();
+      };
+
+      /**
+       * Constructor of a view over a tsvector value in binary format.
+       **/
+      tsvector_view(const char *data = nullptr, int32_t length = 0)
+      : data_(data), length_(length) {}
+
+      int32_t size() const;   /**< Number of lexemes. **/
+      iterator begin() const; /**< First lexeme. **/
+      iterator end() const;   /**< Past-the-end lexeme. **/
+
+      const char *data() const { return data_; }   /**< Binary value. **/
+      int32_t length() const { return length_; }   /**< Number of bytes of the binary value. **/
+
+    private:
+      const char *data_;
+      int32_t     length_;
+    };
+
+    /**
+     * An array of character strings stored contiguously.
+     *
+     * Unlike `asArray<std::string>()`, which allocates a string per element,
+     * all the elements are copied in a single buffer, each one followed by
+     * a null character, with an array of offsets and a bitmap of the null
+     * values. Reading an array costs a few allocations whatever its size.
+     *
+     * ```
+     * text_array tags = row.as<text_array>(0);
+     * for (size_t i = 0; i < tags.size(); i++) {
+     *   if (!tags.isNull(i)) {
+     *     puts(tags[i]);
+     *   }
+     * }
+     * ```
+     **/
+    class text_array {
+    public:
+
+      /**
+       * Number of elements.
+       **/
+      size_t size() const {
+        return nulls_.size();
+      }
+
+      /**
+       * `true` if the element `i` is null.
+       **/
+      bool isNull(size_t i) const {
+        return nulls_[i];
+      }
+
+      /**
+       * Element `i` as a null terminated string, nullptr if it is null.
+       **/
+      const char *operator[](size_t i) const {
+        return nulls_[i] ? nullptr : chars_.data() + offsets_[i];
+      }
+
+      /**
+       * Number of bytes of the element `i`.
+       **/
+      size_t length(size_t i) const {
+        return nulls_[i] ? 0 : offsets_[i + 1] - offsets_[i] - 1;
+      }
+
+#ifdef LIBPQMXX_STRING_VIEW
+      /**
+       * Element `i` as a string view (empty if it is null).
+       **/
+      std::string_view view(size_t i) const {
+        return std::string_view(chars_.data() + offsets_[i], length(i));
+      }
+#endif
+
+      /**
+       * Remove all the elements, keeping the allocated memory.
+       **/
+      void clear();
+
+      /**
+       * Append an element.
+       *
+       * @param value  The characters of the element, or nullptr for a null
+       *               value.
+       * @param length The number of characters.
+       **/
+      void push_back(const char *value, size_t length);
+
+      /**
+       * Read a text array in binary format.
+       **/
+      void read(const char *buf, int32_t length);
+
+    private:
+      std::vector<char>     chars_;
+      std::vector<uint32_t> offsets_ = std::vector<uint32_t>(1, 0); /**< Start of each element, followed by the end of the last one. **/
+      std::vector<bool>     nulls_;
+    };
+
+    /**
+     * A range of values bound as an array parameter.
+     *
+     * Any container can be sent as an array without copying its values in
+     * array_item first. Arrays sent this way have no null values.
+     *
+     * ```
+     * std::deque<int32_t> ids = ...;
+     * cnx.execute("SELECT * FROM employees WHERE emp_no = ANY($1)", make_array(ids.begin(), ids.end()));
+     * ```
+     **/
+    template<typename Iterator>
+    struct array_range {
+      Iterator first; /**< First value. **/
+      Iterator last;  /**< Past-the-end value. **/
+    };
+
+    /**
+     * Range of values between two forward iterators.
+     **/
+    template<typename Iterator>
+    array_range<Iterator> make_array(Iterator first, Iterator last) {
+      return array_range<Iterator> { first, last };
+    }
+
+    /**
+     * Range of `size` values starting at `data`.
+     **/
+    template<typename T>
+    array_range<const T *> make_array(const T *data, size_t size) {
+      return array_range<const T *> { data, data + size };
+    }
+
+    /**
+     * A range value (`int4range`, `int8range`, `daterange`, `tsrange` or
+     * `tstzrange`).
+     *
+     * A default constructed range is empty. The server returns discrete
+     * ranges (integers and dates) in their canonical form `[lower,upper)`.
+     *
+     * ```
+     * range<timestamptz_t> slot = row.as<range<timestamptz_t>>(0);
+     * if (slot.contains(now)) {
+     *   ...
+     * }
+     * ```
+     **/
+    template<typename T>
+    struct range {
+      T     lower;          /**< Lower bound, unless lowerInfinite is true. **/
+      T     upper;          /**< Upper bound, unless upperInfinite is true. **/
+      bool  lowerInclusive; /**< `true` if the lower bound is in the range. **/
+      bool  upperInclusive; /**< `true` if the upper bound is in the range. **/
+      bool  lowerInfinite;  /**< `true` if the range has no lower bound. **/
+      bool  upperInfinite;  /**< `true` if the range has no upper bound. **/
+      bool  empty;          /**< `true` for an empty range. **/
+
+      /**
+       * Constructor of an empty range.
+       **/
+      range()
+      : lower(), upper(), lowerInclusive(false), upperInclusive(false),
+        lowerInfinite(false), upperInfinite(false), empty(true) {}
+
+      /**
+       * Constructor of a range with two bounds.
+       *
+       * @param l  The lower bound.
+       * @param u  The upper bound.
+       * @param li `true` if the lower bound is in the range.
+       * @param ui `true` if the upper bound is in the range.
+       **/
+      range(T l, T u, bool li = true, bool ui = false)
+      : lower(l), upper(u), lowerInclusive(li), upperInclusive(ui),
+        lowerInfinite(false), upperInfinite(false), empty(false) {}
+
+      /**
+       * Check if a value is in the range.
+       **/
+      bool contains(const T &value) const {
+        if (empty) {
+          return false;
+        }
+        if (!lowerInfinite && (lowerInclusive ? value < lower : !(lower < value))) {
+          return false;
+        }
+        if (!upperInfinite && (upperInclusive ? upper < value : !(value < upper))) {
+          return false;
+        }
+        return true;
+      }
+
+      bool operator==(const range<T> &other) const {
+        if (empty || other.empty) {
+          return empty == other.empty;
+        }
+        return lowerInfinite == other.lowerInfinite && upperInfinite == other.upperInfinite
+            && (lowerInfinite || (lower == other.lower && lowerInclusive == other.lowerInclusive))
+            && (upperInfinite || (upper == other.upper && upperInclusive == other.upperInclusive));
+      }
+    };
+
     const int32_t DAYS_UNIX_TO_J2000_EPOCH = int32_t(10957);
     const int64_t MICROSEC_UNIX_TO_J2000_EPOCH = int64_t(946684800) * 1000000;
 
@@ -312,5 +782,1188 @@ namespace db {
     int32_t length(const std::string &value);
     int32_t length(timetz_t value);
 
+    /**
+     * Binding between a C++ type and a PostgreSQL type.
+     *
+     * type_traits is the customization point used by execute() to send
+     * parameters and by Row::as() and Row::asArray() to read values. Support
+     * for a new type is added by specializing type_traits with the following
+     * members:
+     *
+     * ```
+     * struct money_t { int64_t cents; };
+     *
+     * namespace db {
+     *   namespace postgres {
+     *     template<>
+     *     struct type_traits<money_t> {
+     *       static const Oid oid = CASHOID;           // type sent with parameters
+     *       static const Oid arrayOid = CASHARRAYOID; // type of arrays (0 if not supported)
+     *       static bool accepts(Oid type) { return type == CASHOID; }
+     *       static int32_t length(const money_t &) { return 8; }
+     *       static char *write(const money_t &value, char *buf) { return postgres::write(value.cents, buf); }
+     *       static money_t read(const char *buf, int32_t length) { return money_t { read_value<int64_t>(buf, length) }; }
+     *       static money_t null() { return money_t { 0 }; }
+     *     };
+     *   }
+     * }
+     *
+     * auto total = cnx.execute("SELECT SUM(amount) FROM orders").as<money_t>(0);
+     * ```
+     *
+     * Values are always exchanged in the binary format of the PostgreSQL type.
+     *
+     * Types such as enums, domains or types created by extensions have an OID
+     * specific to each database. Their type_traits define an `oid` of `0` and
+     * a `static const char *name()` function returning the name of the
+     * PostgreSQL type. The OIDs are then resolved by name using the catalog
+     * of the connection (see Connection::type()).
+     **/
+    template<typename T>
+    struct type_traits;
+
+    namespace internal {
+
+      /**
+       * A sequence of indexes used to expand a tuple (std::index_sequence is
+       * only available from C++14).
+       **/
+      template<size_t... I>
+      struct index_sequence {};
+
+      template<size_t N, size_t... I>
+      struct make_index_sequence : make_index_sequence<N - 1, N - 1, I...> {};
+
+      template<size_t... I>
+      struct make_index_sequence<0, I...> {
+        typedef index_sequence<I...> type;
+      };
+
+      /**
+       * True for C strings: pointers to char and char arrays, which are bound
+       * as `const char *` rather than through type_traits.
+       **/
+      template<typename T>
+      struct is_c_string : std::integral_constant<bool,
+        std::is_same<typename std::decay<T>::type, char *>::value
+        || std::is_same<typename std::decay<T>::type, const char *>::value> {};
+
+    } // namespace internal
+
+    /**
+     * Read a value from a buffer that does not need to be moved forward.
+     *
+     * @param buf    A pointer to a buffer containing a postgresql value.
+     * @param length Number of bytes of the value.
+     * @return The value read from the buffer.
+     **/
+    template<typename T>
+    T read_value(const char *buf, int32_t length) {
+      char *p = const_cast<char *>(buf);
+      return read<T>(&p, size_t(length));
+    }
+
+    /**
+     * type_traits of a type using read(), write() and length() to convert
+     * values from and to the binary format of a PostgreSQL type.
+     **/
+    template<typename T, Oid OID, Oid ARRAYOID>
+    struct binary_type_traits {
+      static const Oid oid = OID;
+      static const Oid arrayOid = ARRAYOID;
+
+      static bool accepts(Oid type) {
+        return type == OID;
+      }
+
+      static int32_t length(const T &value) {
+        return postgres::length(value);
+      }
+
+      static char *write(const T &value, char *buf) {
+        return postgres::write(value, buf);
+      }
+
+      static T read(const char *buf, int32_t length) {
+        return read_value<T>(buf, length);
+      }
+
+      static T null() {
+        return T();
+      }
+    };
+
+    template<> struct type_traits<bool>          : binary_type_traits<bool, BOOLOID, BOOLARRAYOID> {};
+    template<> struct type_traits<int16_t>       : binary_type_traits<int16_t, INT2OID, INT2ARRAYOID> {};
+    template<> struct type_traits<int32_t>       : binary_type_traits<int32_t, INT4OID, INT4ARRAYOID> {};
+    template<> struct type_traits<int64_t>       : binary_type_traits<int64_t, INT8OID, INT8ARRAYOID> {};
+    template<> struct type_traits<float>         : binary_type_traits<float, FLOAT4OID, FLOAT4ARRAYOID> {};
+    template<> struct type_traits<double>        : binary_type_traits<double, FLOAT8OID, FLOAT8ARRAYOID> {};
+    template<> struct type_traits<date_t>        : binary_type_traits<date_t, DATEOID, DATEARRAYOID> {};
+    template<> struct type_traits<time_t>        : binary_type_traits<time_t, TIMEOID, TIMEARRAYOID> {};
+    template<> struct type_traits<timetz_t>      : binary_type_traits<timetz_t, TIMETZOID, TIMETZARRAYOID> {};
+    template<> struct type_traits<timestamp_t>   : binary_type_traits<timestamp_t, TIMESTAMPOID, TIMESTAMPARRAYOID> {};
+    template<> struct type_traits<timestamptz_t> : binary_type_traits<timestamptz_t, TIMESTAMPTZOID, TIMESTAMPTZARRAYOID> {};
+    template<> struct type_traits<interval_t>    : binary_type_traits<interval_t, INTERVALOID, INTERVALARRAYOID> {};
+
+    /**
+     * `"char"`
+     **/
+    template<>
+    struct type_traits<char> : binary_type_traits<char, CHAROID, CHARARRAYOID> {
+      static bool accepts(Oid) {
+        return true;
+      }
+
+      static char read(const char *buf, int32_t length) {
+        return length > 0 ? *buf : '\0';
+      }
+    };
+
+    /**
+     * Character types.
+     *
+     * Any value can be read as a string. This is convenient for types that
+     * are not supported by the library and have a text-like binary format
+     * (enum, json...).
+     **/
+    template<>
+    struct type_traits<std::string> : binary_type_traits<std::string, VARCHAROID, VARCHARARRAYOID> {
+      static bool accepts(Oid) {
+        return true;
+      }
+
+      static std::string read(const char *buf, int32_t length) {
+        return std::string(buf, size_t(length));
+      }
+    };
+
+    /**
+     * Character types, read without copy.
+     *
+     * The value is only valid as long as the result holding it.
+     **/
+    template<>
+    struct type_traits<const char *> {
+      static const Oid oid = VARCHAROID;
+      static const Oid arrayOid = VARCHARARRAYOID;
+
+      static bool accepts(Oid) {
+        return true;
+      }
+
+      static int32_t length(const char *value) {
+        return int32_t(std::strlen(value));
+      }
+
+      static char *write(const char *value, char *buf) {
+        size_t length = std::strlen(value);
+        std::memcpy(buf, value, length);
+        return buf + length;
+      }
+
+      static const char *read(const char *buf, int32_t) {
+        return buf;
+      }
+
+      static const char *null() {
+        return nullptr;
+      }
+    };
+
+#ifdef LIBPQMXX_STRING_VIEW
+    /**
+     * Character types, read without copy.
+     *
+     * The value is only valid as long as the result holding it.
+     **/
+    template<>
+    struct type_traits<std::string_view> {
+      static const Oid oid = VARCHAROID;
+      static const Oid arrayOid = VARCHARARRAYOID;
+
+      static bool accepts(Oid) {
+        return true;
+      }
+
+      static int32_t length(std::string_view value) {
+        return int32_t(value.length());
+      }
+
+      static char *write(std::string_view value, char *buf) {
+        std::memcpy(buf, value.data(), value.length());
+        return buf + value.length();
+      }
+
+      static std::string_view read(const char *buf, int32_t length) {
+        return std::string_view(buf, size_t(length));
+      }
+
+      static std::string_view null() {
+        return std::string_view();
+      }
+    };
+#endif
+
+    /**
+     * Arrays of character types read into contiguous storage, and sent as
+     * an array of `character varying`.
+     **/
+    template<>
+    struct type_traits<text_array> {
+      static const Oid oid = VARCHARARRAYOID;
+      static const Oid arrayOid = 0;
+
+      static bool accepts(Oid type) {
+        return type == TEXTARRAYOID || type == VARCHARARRAYOID || type == BPCHARARRAYOID;
+      }
+
+      static int32_t length(const text_array &value);
+      static char *write(const text_array &value, char *buf);
+
+      static text_array read(const char *buf, int32_t length) {
+        text_array value;
+        value.read(buf, length);
+        return value;
+      }
+
+      static text_array null() {
+        return text_array();
+      }
+    };
+
+    namespace internal {
+
+      // -----------------------------------------------------------------------
+      // Read a value reusing the memory it has already allocated.
+      // -----------------------------------------------------------------------
+      template<typename T>
+      void read_into(const char *buf, int32_t length, T &value) {
+        value = type_traits<T>::read(buf, length);
+      }
+
+      inline void read_into(const char *buf, int32_t length, std::string &value) {
+        value.assign(buf, size_t(length));
+      }
+
+      inline void read_into(const char *buf, int32_t length, std::vector<uint8_t> &value) {
+        value.assign(buf, buf + length);
+      }
+
+      inline void read_into(const char *buf, int32_t length, text_array &value) {
+        value.read(buf, length);
+      }
+
+      template<typename T>
+      void read_null(T &value) {
+        value = type_traits<T>::null();
+      }
+
+      inline void read_null(std::string &value) {
+        value.clear();
+      }
+
+      inline void read_null(std::vector<uint8_t> &value) {
+        value.clear();
+      }
+
+      inline void read_null(text_array &value) {
+        value.clear();
+      }
+
+      /**
+       * Read a value received in text format.
+       *
+       * Results are received in binary format, except for the commands
+       * executed together in a single call to execute() for which PostgreSQL
+       * only supports the text format. Numbers, booleans, character strings,
+       * `bytea` values (hex format), dates and timestamps (ISO `DateStyle`)
+       * can be read from the text format.
+       **/
+      template<typename T, typename Enable = void>
+      struct text_reader {
+        static T read(const char *, int32_t) {
+          throw ExecutionException("The C++ type cannot be read from a result in text format.");
+        }
+      };
+
+      template<typename T>
+      struct text_reader<T, typename std::enable_if<std::is_integral<T>::value
+                                                    && !std::is_same<T, bool>::value
+                                                    && !std::is_same<T, char>::value>::type> {
+        static T read(const char *buf, int32_t length) {
+          typedef typename std::make_unsigned<T>::type U;
+          const char *p = buf;
+          const char *end = buf + length;
+          bool negative = p < end && *p == '-';
+          if (negative) {
+            p++;
+          }
+          // Magnitude of the smallest or of the largest value of T.
+          U limit = negative ? U(U(0) - U(std::numeric_limits<T>::min())) : U(std::numeric_limits<T>::max());
+          U value = 0;
+          bool valid = p < end;
+          for (; valid && p < end; p++) {
+            unsigned digit = unsigned(*p - '0');
+            valid = digit <= 9 && digit <= limit && value <= U(limit - digit) / 10;
+            value = U(value * 10 + digit);
+          }
+          if (!valid) {
+            throw ExecutionException("Invalid value \"" + std::string(buf, size_t(length)) +
+                                     "\" for the C++ integer type.");
+          }
+          return negative ? T(U(0) - value) : T(value);
+        }
+      };
+
+      template<>
+      struct text_reader<float> {
+        static float read(const char *buf, int32_t length);
+      };
+
+      template<>
+      struct text_reader<double> {
+        static double read(const char *buf, int32_t length);
+      };
+
+      template<>
+      struct text_reader<bool> {
+        static bool read(const char *buf, int32_t length) { return length > 0 && *buf == 't'; }
+      };
+
+      // Character strings are the same in text and binary formats.
+      template<typename T>
+      struct text_reader<T, typename std::enable_if<std::is_same<T, char>::value
+                                                    || std::is_same<T, std::string>::value
+                                                    || std::is_same<T, const char *>::value
+#ifdef LIBPQMXX_STRING_VIEW
+                                                    || std::is_same<T, std::string_view>::value
+#endif
+                                                    >::type> {
+        static T read(const char *buf, int32_t length) { return type_traits<T>::read(buf, length); }
+      };
+
+      template<>
+      struct text_reader<std::vector<uint8_t>> {
+        static std::vector<uint8_t> read(const char *buf, int32_t length);
+      };
+
+      template<>
+      struct text_reader<date_t> {
+        static date_t read(const char *buf, int32_t length);
+      };
+
+      template<>
+      struct text_reader<timestamp_t> {
+        static timestamp_t read(const char *buf, int32_t length);
+      };
+
+      template<>
+      struct text_reader<timestamptz_t> {
+        static timestamptz_t read(const char *buf, int32_t length);
+      };
+
+      template<typename T>
+      void read_text_into(const char *buf, int32_t length, T &value) {
+        value = text_reader<T>::read(buf, length);
+      }
+
+      inline void read_text_into(const char *buf, int32_t length, std::string &value) {
+        value.assign(buf, size_t(length));
+      }
+
+      /**
+       * First element of a one dimension array in binary format.
+       *
+       * @param value    The array, nullptr for a null array.
+       * @param size     Set to the number of elements (0 for a null array).
+       * @param elemType Set to the type of the elements.
+       * @return The start of the first element.
+       **/
+      const char *array_elements(const char *value, int32_t &size, Oid &elemType);
+
+      // -----------------------------------------------------------------------
+      // Read an array into a vector, reusing its elements.
+      // -----------------------------------------------------------------------
+      template<typename T>
+      size_t read_array(const char *value, std::vector<T> &array) {
+        int32_t size;
+        Oid elemType;
+        const char *buf = array_elements(value, size, elemType);
+        assert((size == 0 || type_traits<T>::accepts(elemType)) && "Unexpected C++ type for the array");
+        (void)elemType;
+
+        array.resize(size_t(size));
+        for (int32_t i = 0; i < size; i++) {
+          int32_t elemSize = read_value<int32_t>(buf, sizeof(int32_t));
+          buf += sizeof(int32_t);
+          if (elemSize == -1) {
+            read_null(array[i]);
+          }
+          else {
+            read_into(buf, elemSize, array[i]);
+            buf += elemSize;
+          }
+        }
+        return array.size();
+      }
+
+      template<typename T>
+      size_t read_array(const char *value, std::vector<array_item<T>> &array) {
+        int32_t size;
+        Oid elemType;
+        const char *buf = array_elements(value, size, elemType);
+        assert((size == 0 || type_traits<T>::accepts(elemType)) && "Unexpected C++ type for the array");
+        (void)elemType;
+
+        array.resize(size_t(size));
+        for (int32_t i = 0; i < size; i++) {
+          int32_t elemSize = read_value<int32_t>(buf, sizeof(int32_t));
+          buf += sizeof(int32_t);
+          array[i].isNull = elemSize == -1;
+          if (array[i].isNull) {
+            read_null(array[i].value);
+          }
+          else {
+            read_into(buf, elemSize, array[i].value);
+            buf += elemSize;
+          }
+        }
+        return array.size();
+      }
+
+    } // namespace internal
+
+    /**
+     * `bytea`, read without copy.
+     **/
+    template<>
+    struct type_traits<bytea_view> {
+      static const Oid oid = BYTEAOID;
+      static const Oid arrayOid = BYTEAARRAYOID;
+
+      static bool accepts(Oid type) {
+        return type == BYTEAOID;
+      }
+
+      static int32_t length(const bytea_view &value) {
+        return int32_t(value.size);
+      }
+
+      static char *write(const bytea_view &value, char *buf) {
+        std::memcpy(buf, value.data, value.size);
+        return buf + value.size;
+      }
+
+      static bytea_view read(const char *buf, int32_t length) {
+        return bytea_view(buf, size_t(length));
+      }
+
+      static bytea_view null() {
+        return bytea_view();
+      }
+    };
+
+    /**
+     * `bytea`
+     **/
+    template<>
+    struct type_traits<std::vector<uint8_t>> {
+      static const Oid oid = BYTEAOID;
+      static const Oid arrayOid = BYTEAARRAYOID;
+
+      static bool accepts(Oid type) {
+        return type == BYTEAOID;
+      }
+
+      static int32_t length(const std::vector<uint8_t> &value) {
+        return int32_t(value.size());
+      }
+
+      static char *write(const std::vector<uint8_t> &value, char *buf) {
+        std::memcpy(buf, value.data(), value.size());
+        return buf + value.size();
+      }
+
+      static std::vector<uint8_t> read(const char *buf, int32_t length) {
+        const uint8_t *data = reinterpret_cast<const uint8_t *>(buf);
+        return std::vector<uint8_t>(data, data + length);
+      }
+
+      static std::vector<uint8_t> null() {
+        return std::vector<uint8_t>();
+      }
+    };
+
+    /**
+     * type_traits of `inet` and `cidr` values.
+     *
+     * The binary format is the family, the number of bits of the netmask, a
+     * cidr flag and the number of bytes of the address, followed by the
+     * address. `cidr` values can also be read as inet_t.
+     **/
+    template<typename T, Oid OID, Oid ARRAYOID>
+    struct inet_type_traits {
+      static const Oid oid = OID;
+      static const Oid arrayOid = ARRAYOID;
+
+      static bool accepts(Oid type) {
+        return type == OID || (OID == INETOID && type == CIDROID);
+      }
+
+      static int32_t length(const T &value) {
+        return 4 + value.size();
+      }
+
+      static char *write(const T &value, char *buf) {
+        *buf++ = char(value.family == 6 ? FAMILY_INET6 : FAMILY_INET);
+        *buf++ = char(value.bits);
+        *buf++ = char(OID == CIDROID);
+        *buf++ = char(value.size());
+        std::memcpy(buf, value.address, size_t(value.size()));
+        return buf + value.size();
+      }
+
+      static T read(const char *buf, int32_t) {
+        T value = T();
+        value.family = buf[0] == FAMILY_INET6 ? 6 : 4;
+        value.bits = uint8_t(buf[1]);
+        std::memcpy(value.address, buf + 4, std::min(size_t(uint8_t(buf[3])), sizeof(value.address)));
+        return value;
+      }
+
+      static T null() {
+        return T();
+      }
+
+    private:
+      // Families sent by the server (PGSQL_AF_INET and PGSQL_AF_INET6).
+      enum {
+        FAMILY_INET = 2,
+        FAMILY_INET6 = 3
+      };
+    };
+
+    template<> struct type_traits<inet_t> : inet_type_traits<inet_t, INETOID, INETARRAYOID> {};
+    template<> struct type_traits<cidr_t> : inet_type_traits<cidr_t, CIDROID, CIDRARRAYOID> {};
+
+    /**
+     * type_traits of `macaddr` values: the 6 bytes of the address.
+     **/
+    template<>
+    struct type_traits<macaddr_t> {
+      static const Oid oid = MACADDROID;
+      static const Oid arrayOid = MACADDRARRAYOID;
+
+      static bool accepts(Oid type) {
+        return type == MACADDROID;
+      }
+
+      static int32_t length(const macaddr_t &value) {
+        return int32_t(sizeof(value.address));
+      }
+
+      static char *write(const macaddr_t &value, char *buf) {
+        std::memcpy(buf, value.address, sizeof(value.address));
+        return buf + sizeof(value.address);
+      }
+
+      static macaddr_t read(const char *buf, int32_t) {
+        macaddr_t value;
+        std::memcpy(value.address, buf, sizeof(value.address));
+        return value;
+      }
+
+      static macaddr_t null() {
+        return macaddr_t();
+      }
+    };
+
+    /**
+     * type_traits of views over values in binary format, which are written
+     * back as they were read.
+     **/
+    template<typename T, Oid OID, Oid ARRAYOID>
+    struct view_type_traits {
+      static const Oid oid = OID;
+      static const Oid arrayOid = ARRAYOID;
+
+      static bool accepts(Oid type) {
+        return OID == 0 || type == OID;
+      }
+
+      static int32_t length(const T &value) {
+        return value.length();
+      }
+
+      static char *write(const T &value, char *buf) {
+        std::memcpy(buf, value.data(), size_t(value.length()));
+        return buf + value.length();
+      }
+
+      static T read(const char *buf, int32_t length) {
+        return T(buf, length);
+      }
+
+      static T null() {
+        return T();
+      }
+    };
+
+    /**
+     * hstore is an extension: its OID is resolved by name.
+     **/
+    template<>
+    struct type_traits<hstore_view> : view_type_traits<hstore_view, 0, 0> {
+      static const char *name() { return "hstore"; }
+    };
+
+    template<>
+    struct type_traits<tsvector_view> : view_type_traits<tsvector_view, TSVECTOROID, TSVECTORARRAYOID> {};
+
+    /**
+     * type_traits of ranges of T.
+     *
+     * The binary format of a range is a byte of flags followed by the lower
+     * and the upper bounds when they are finite, each prefixed by its length.
+     **/
+    template<typename T, Oid OID, Oid ARRAYOID>
+    struct range_type_traits {
+      static const Oid oid = OID;
+      static const Oid arrayOid = ARRAYOID;
+
+      static bool accepts(Oid type) {
+        return type == OID;
+      }
+
+      static int32_t length(const range<T> &value) {
+        int32_t length = 1;
+        if (!value.empty && !value.lowerInfinite) {
+          length += sizeof(int32_t) + type_traits<T>::length(value.lower);
+        }
+        if (!value.empty && !value.upperInfinite) {
+          length += sizeof(int32_t) + type_traits<T>::length(value.upper);
+        }
+        return length;
+      }
+
+      static char *write(const range<T> &value, char *buf) {
+        int flags = value.empty ? int(EMPTY) : 0;
+        if (!value.empty) {
+          flags |= value.lowerInfinite ? int(LOWER_INFINITE) : (value.lowerInclusive ? int(LOWER_INCLUSIVE) : 0);
+          flags |= value.upperInfinite ? int(UPPER_INFINITE) : (value.upperInclusive ? int(UPPER_INCLUSIVE) : 0);
+        }
+        *buf++ = char(flags);
+        if (!(flags & (EMPTY | LOWER_INFINITE))) {
+          buf = postgres::write(type_traits<T>::length(value.lower), buf);
+          buf = type_traits<T>::write(value.lower, buf);
+        }
+        if (!(flags & (EMPTY | UPPER_INFINITE))) {
+          buf = postgres::write(type_traits<T>::length(value.upper), buf);
+          buf = type_traits<T>::write(value.upper, buf);
+        }
+        return buf;
+      }
+
+      static range<T> read(const char *buf, int32_t) {
+        range<T> value;
+        int flags = uint8_t(*buf++);
+        if (flags & EMPTY) {
+          return value;
+        }
+        value.empty = false;
+        value.lowerInclusive = (flags & LOWER_INCLUSIVE) != 0;
+        value.upperInclusive = (flags & UPPER_INCLUSIVE) != 0;
+        value.lowerInfinite = (flags & LOWER_INFINITE) != 0;
+        value.upperInfinite = (flags & UPPER_INFINITE) != 0;
+        if (!value.lowerInfinite) {
+          int32_t length = read_value<int32_t>(buf, sizeof(int32_t));
+          value.lower = type_traits<T>::read(buf + sizeof(int32_t), length);
+          buf += sizeof(int32_t) + length;
+        }
+        if (!value.upperInfinite) {
+          int32_t length = read_value<int32_t>(buf, sizeof(int32_t));
+          value.upper = type_traits<T>::read(buf + sizeof(int32_t), length);
+        }
+        return value;
+      }
+
+      static range<T> null() {
+        return range<T>();
+      }
+
+    private:
+      // Flags of a range (see rangetypes.h in PostgreSQL).
+      enum {
+        EMPTY = 0x01,
+        LOWER_INCLUSIVE = 0x02,
+        UPPER_INCLUSIVE = 0x04,
+        LOWER_INFINITE = 0x08,
+        UPPER_INFINITE = 0x10
+      };
+    };
+
+    template<> struct type_traits<range<int32_t>>       : range_type_traits<int32_t, INT4RANGEOID, INT4RANGEARRAYOID> {};
+    template<> struct type_traits<range<int64_t>>       : range_type_traits<int64_t, INT8RANGEOID, INT8RANGEARRAYOID> {};
+    template<> struct type_traits<range<date_t>>        : range_type_traits<date_t, DATERANGEOID, DATERANGEARRAYOID> {};
+    template<> struct type_traits<range<timestamp_t>>   : range_type_traits<timestamp_t, TSRANGEOID, TSRANGEARRAYOID> {};
+    template<> struct type_traits<range<timestamptz_t>> : range_type_traits<timestamptz_t, TSTZRANGEOID, TSTZRANGEARRAYOID> {};
+
+    /**
+     * type_traits of `date` values read as a number of days since the Unix
+     * epoch in a std::chrono::time_point (`std::chrono::sys_days` in C++20).
+     **/
+    template<typename Duration>
+    struct date_type_traits {
+      typedef std::chrono::time_point<std::chrono::system_clock, Duration> value_type;
+
+      static const Oid oid = DATEOID;
+      static const Oid arrayOid = DATEARRAYOID;
+
+      static bool accepts(Oid type) {
+        return type == DATEOID;
+      }
+
+      static int32_t length(const value_type &) {
+        return sizeof(int32_t);
+      }
+
+      static char *write(const value_type &value, char *buf) {
+        if (value == value_type::max()) {
+          return postgres::write(std::numeric_limits<int32_t>::max(), buf);
+        }
+        if (value == value_type::min()) {
+          return postgres::write(std::numeric_limits<int32_t>::min(), buf);
+        }
+        return postgres::write(int32_t(value.time_since_epoch().count()) - DAYS_UNIX_TO_J2000_EPOCH, buf);
+      }
+
+      // `infinity` and `-infinity` are read as the max() and min() time points.
+      static value_type read(const char *buf, int32_t length) {
+        int32_t days = read_value<int32_t>(buf, length);
+        if (days == std::numeric_limits<int32_t>::max()) {
+          return value_type::max();
+        }
+        if (days == std::numeric_limits<int32_t>::min()) {
+          return value_type::min();
+        }
+        return value_type(Duration(typename Duration::rep(int64_t(days) + DAYS_UNIX_TO_J2000_EPOCH)));
+      }
+
+      static value_type null() {
+        return value_type();
+      }
+    };
+
+    /**
+     * type_traits of `timestamp with time zone` values read as a
+     * std::chrono::time_point of the system clock (whose epoch is the Unix
+     * epoch). `timestamp without time zone` values are read as UTC.
+     **/
+    template<typename Duration>
+    struct timestamp_type_traits {
+      typedef std::chrono::time_point<std::chrono::system_clock, Duration> value_type;
+
+      static const Oid oid = TIMESTAMPTZOID;
+      static const Oid arrayOid = TIMESTAMPTZARRAYOID;
+
+      static bool accepts(Oid type) {
+        return type == TIMESTAMPTZOID || type == TIMESTAMPOID;
+      }
+
+      static int32_t length(const value_type &) {
+        return sizeof(int64_t);
+      }
+
+      static char *write(const value_type &value, char *buf) {
+        if (value == value_type::max()) {
+          return postgres::write(std::numeric_limits<int64_t>::max(), buf);
+        }
+        if (value == value_type::min()) {
+          return postgres::write(std::numeric_limits<int64_t>::min(), buf);
+        }
+        int64_t time = std::chrono::duration_cast<std::chrono::microseconds>(value.time_since_epoch()).count();
+        return postgres::write(time - MICROSEC_UNIX_TO_J2000_EPOCH, buf);
+      }
+
+      // `infinity` and `-infinity` are read as the max() and min() time points.
+      static value_type read(const char *buf, int32_t length) {
+        int64_t time = read_value<int64_t>(buf, length);
+        if (time == std::numeric_limits<int64_t>::max()) {
+          return value_type::max();
+        }
+        if (time == std::numeric_limits<int64_t>::min()) {
+          return value_type::min();
+        }
+
+        // The range of the duration, such as the nanoseconds of the system
+        // clock (about 292 years around 1970), may be smaller than PostgreSQL's.
+        typedef std::chrono::duration<double, std::micro> double_microseconds;
+        double since = double(time) + double(MICROSEC_UNIX_TO_J2000_EPOCH);
+        if (time > std::numeric_limits<int64_t>::max() - MICROSEC_UNIX_TO_J2000_EPOCH
+            || since >= double_microseconds(Duration::max()).count()
+            || since <= double_microseconds(Duration::min()).count()) {
+          throw ExecutionException("The timestamp is out of the range of the C++ time point.");
+        }
+        std::chrono::microseconds micros(time + MICROSEC_UNIX_TO_J2000_EPOCH);
+        return value_type(std::chrono::duration_cast<Duration>(micros));
+      }
+
+      static value_type null() {
+        return value_type();
+      }
+    };
+
+    /**
+     * Time points of the system clock: dates when the duration is a number
+     * of days, timestamps otherwise.
+     *
+     * ```
+     * auto created = row.as<std::chrono::system_clock::time_point>(0);
+     * ```
+     **/
+    template<typename Duration>
+    struct type_traits<std::chrono::time_point<std::chrono::system_clock, Duration>>
+      : std::conditional<std::is_same<typename Duration::period, std::ratio<86400>>::value,
+                         date_type_traits<Duration>,
+                         timestamp_type_traits<Duration>>::type {};
+
+    /**
+     * Durations are sent as an `interval` of microseconds. `interval` and
+     * `time` values are read as a duration, counting 24 hours per day and
+     * 30 days per month like `justify_interval()`.
+     **/
+    template<typename Rep, typename Period>
+    struct type_traits<std::chrono::duration<Rep, Period>> {
+      typedef std::chrono::duration<Rep, Period> value_type;
+
+      static const Oid oid = INTERVALOID;
+      static const Oid arrayOid = INTERVALARRAYOID;
+
+      static bool accepts(Oid type) {
+        return type == INTERVALOID || type == TIMEOID;
+      }
+
+      static int32_t length(const value_type &) {
+        return 16;
+      }
+
+      static char *write(const value_type &value, char *buf) {
+        buf = postgres::write(int64_t(std::chrono::duration_cast<std::chrono::microseconds>(value).count()), buf);
+        buf = postgres::write(int32_t(0), buf); // days
+        return postgres::write(int32_t(0), buf); // months
+      }
+
+      static value_type read(const char *buf, int32_t length) {
+        int64_t time = read_value<int64_t>(buf, sizeof(int64_t));
+        if (length > int32_t(sizeof(int64_t))) {
+          int64_t days = read_value<int32_t>(buf + 8, sizeof(int32_t))
+                       + int64_t(read_value<int32_t>(buf + 12, sizeof(int32_t))) * 30;
+          time += days * 86400000000;
+        }
+        return std::chrono::duration_cast<value_type>(std::chrono::microseconds(time));
+      }
+
+      static value_type null() {
+        return value_type();
+      }
+    };
+
+    /**
+     * type_traits of a C++ enum mapped to a PostgreSQL enum.
+     *
+     * The mapping between the values of the C++ enum and the labels of the
+     * PostgreSQL enum is given by a `labels()` function. Labels read from the
+     * database are looked up in a table sorted once, so decoding a value
+     * does not compare it with every label.
+     *
+     * ```
+     * enum class mood { sad, ok, happy };
+     *
+     * namespace db {
+     *   namespace postgres {
+     *     template<>
+     *     struct type_traits<mood> : enum_type_traits<mood> {
+     *       static const char *name() { return "mood"; }
+     *       static std::vector<std::pair<mood, const char *>> labels() {
+     *         return { { mood::sad, "sad" }, { mood::ok, "ok" }, { mood::happy, "happy" } };
+     *       }
+     *     };
+     *   }
+     * }
+     *
+     * cnx.execute("INSERT INTO person VALUES ($1, $2)", "Moe", mood::happy);
+     * ```
+     **/
+    template<typename T>
+    struct enum_type_traits {
+      static const Oid oid = 0;       /**< Resolved by name(). **/
+      static const Oid arrayOid = 0;  /**< Resolved by name(). **/
+
+      static bool accepts(Oid) {
+        return true;
+      }
+
+      static int32_t length(const T &value) {
+        return int32_t(std::strlen(label(value)));
+      }
+
+      static char *write(const T &value, char *buf) {
+        const char *s = label(value);
+        size_t length = std::strlen(s);
+        std::memcpy(buf, s, length);
+        return buf + length;
+      }
+
+      static T read(const char *buf, int32_t length) {
+        const std::vector<std::pair<std::string, T>> &values = table();
+        auto value = std::lower_bound(values.begin(), values.end(), std::make_pair(buf, length),
+          [](const std::pair<std::string, T> &entry, const std::pair<const char *, int32_t> &key) {
+            return compare(entry.first, key.first, key.second) < 0;
+          });
+        if (value == values.end() || compare(value->first, buf, length) != 0) {
+          throw ExecutionException("Unknown enum label: " + std::string(buf, size_t(length)));
+        }
+        return value->second;
+      }
+
+      static T null() {
+        return T();
+      }
+
+    private:
+
+      static const char *label(const T &value) {
+        for (auto &entry: entries()) {
+          if (entry.first == value) {
+            return entry.second;
+          }
+        }
+        throw ExecutionException("Enum value without label");
+      }
+
+      static const std::vector<std::pair<T, const char *>> &entries() {
+        static const std::vector<std::pair<T, const char *>> entries = type_traits<T>::labels();
+        return entries;
+      }
+
+      // -----------------------------------------------------------------------
+      // Labels sorted by length, then by content.
+      // -----------------------------------------------------------------------
+      static int compare(const std::string &label, const char *buf, int32_t length) {
+        if (int32_t(label.length()) != length) {
+          return int32_t(label.length()) < length ? -1 : 1;
+        }
+        return std::memcmp(label.data(), buf, size_t(length));
+      }
+
+      static const std::vector<std::pair<std::string, T>> &table() {
+        static const std::vector<std::pair<std::string, T>> table = [] {
+          std::vector<std::pair<std::string, T>> table;
+          for (auto &entry: entries()) {
+            table.push_back(std::make_pair(std::string(entry.second), entry.first));
+          }
+          std::sort(table.begin(), table.end(),
+            [](const std::pair<std::string, T> &a, const std::pair<std::string, T> &b) {
+              return compare(a.first, b.first.data(), int32_t(b.first.length())) < 0;
+            });
+          return table;
+        }();
+        return table;
+      }
+    };
+
+    namespace internal {
+
+      // -----------------------------------------------------------------------
+      // Fields of a composite value:
+      //
+      // struct pg_record {
+      //   int32_t nfields;   /* Number of fields */
+      //
+      //   /* For each field */
+      //   Oid     type;      /* Type of the field */
+      //   int32_t length;    /* Length of the value, -1 if null */
+      //   T       value;     /* Value of the field */
+      // }
+      // -----------------------------------------------------------------------
+      template<typename F>
+      int32_t field_length(const F &field) {
+        return 2 * sizeof(int32_t) + type_traits<F>::length(field);
+      }
+
+      template<typename F>
+      void write_field(char *&buf, const F &field) {
+        static_assert(type_traits<F>::oid != 0, "the fields of a composite parameter must have a static OID");
+        buf = write(int32_t(type_traits<F>::oid), buf);
+        buf = write(type_traits<F>::length(field), buf);
+        buf = type_traits<F>::write(field, buf);
+      }
+
+      template<typename F>
+      void read_field(const char *&buf, F &field) {
+        Oid type = Oid(read_value<int32_t>(buf, sizeof(int32_t)));
+        int32_t length = read_value<int32_t>(buf + sizeof(int32_t), sizeof(int32_t));
+        buf += 2 * sizeof(int32_t);
+        if (length < 0) {
+          field = type_traits<F>::null();
+          return;
+        }
+        assert(type_traits<F>::accepts(type) && "Unexpected C++ type for the field");
+        (void)type;
+        field = type_traits<F>::read(buf, length);
+        buf += length;
+      }
+
+      template<typename... F, size_t... I>
+      int32_t fields_length(const std::tuple<F&...> &fields, index_sequence<I...>) {
+        int32_t length = sizeof(int32_t);
+        int32_t lengths[] = { 0, field_length(std::get<I>(fields))... };
+        for (int32_t l: lengths) {
+          length += l;
+        }
+        return length;
+      }
+
+      template<typename... F, size_t... I>
+      char *write_fields(char *buf, const std::tuple<F&...> &fields, index_sequence<I...>) {
+        buf = write(int32_t(sizeof...(F)), buf);
+        int expand[] = { 0, (write_field(buf, std::get<I>(fields)), 0)... };
+        (void)expand;
+        return buf;
+      }
+
+      template<typename... F, size_t... I>
+      void read_fields(const char *buf, const std::tuple<F&...> &fields, index_sequence<I...>) {
+        if (read_value<int32_t>(buf, sizeof(int32_t)) != int32_t(sizeof...(F))) {
+          throw ExecutionException("Unexpected number of fields in a composite value.");
+        }
+        buf += sizeof(int32_t);
+        int expand[] = { 0, (read_field(buf, std::get<I>(fields)), 0)... };
+        (void)expand;
+      }
+
+      // -----------------------------------------------------------------------
+      // Numbers stored in arrays with an inline byte swap.
+      // -----------------------------------------------------------------------
+      template<typename T>
+      struct is_fixed_width : std::false_type {};
+
+      template<> struct is_fixed_width<int16_t> : std::true_type { typedef uint16_t bits_type; };
+      template<> struct is_fixed_width<int32_t> : std::true_type { typedef uint32_t bits_type; };
+      template<> struct is_fixed_width<int64_t> : std::true_type { typedef uint64_t bits_type; };
+      template<> struct is_fixed_width<float>   : std::true_type { typedef uint32_t bits_type; };
+      template<> struct is_fixed_width<double>  : std::true_type { typedef uint64_t bits_type; };
+
+      inline char *store_big_endian(uint16_t value, char *buf) {
+        buf[0] = char(value >> 8);
+        buf[1] = char(value);
+        return buf + 2;
+      }
+
+      inline char *store_big_endian(uint32_t value, char *buf) {
+        buf[0] = char(value >> 24);
+        buf[1] = char(value >> 16);
+        buf[2] = char(value >> 8);
+        buf[3] = char(value);
+        return buf + 4;
+      }
+
+      inline char *store_big_endian(uint64_t value, char *buf) {
+        store_big_endian(uint32_t(value >> 32), buf);
+        return store_big_endian(uint32_t(value), buf + 4);
+      }
+
+    } // namespace internal
+
+    /**
+     * type_traits of a C++ type mapped to a PostgreSQL composite type.
+     *
+     * The fields of the C++ type are given by a `tie()` function returning a
+     * tuple of references, in the order of the attributes of the composite
+     * type. Each field is converted using its own type_traits, including
+     * nested composites and arrays of composites.
+     *
+     * ```
+     * struct point { double x; double y; };
+     *
+     * namespace db {
+     *   namespace postgres {
+     *     template<>
+     *     struct type_traits<point> : composite_type_traits<point> {
+     *       static const char *name() { return "point2d"; }
+     *       static std::tuple<double &, double &> tie(point &p) { return std::tie(p.x, p.y); }
+     *     };
+     *   }
+     * }
+     *
+     * point p = cnx.execute("SELECT location FROM places").as<point>(0);
+     * ```
+     *
+     * Values are only checked to have the expected number of fields: the
+     * OIDs of composite types are specific to each database, so any
+     * composite or record column is accepted.
+     **/
+    template<typename T>
+    struct composite_type_traits {
+      static const Oid oid = 0;       /**< Resolved by name(). **/
+      static const Oid arrayOid = 0;  /**< Resolved by name(). **/
+
+      static bool accepts(Oid) {
+        return true;
+      }
+
+      // tie() is only used to access the fields: a value that is written is
+      // not modified.
+
+      static int32_t length(const T &value) {
+        T &fields = const_cast<T &>(value);
+        return internal::fields_length(type_traits<T>::tie(fields), sequence(type_traits<T>::tie(fields)));
+      }
+
+      static char *write(const T &value, char *buf) {
+        T &fields = const_cast<T &>(value);
+        return internal::write_fields(buf, type_traits<T>::tie(fields), sequence(type_traits<T>::tie(fields)));
+      }
+
+      static T read(const char *buf, int32_t) {
+        T value = type_traits<T>::null();
+        internal::read_fields(buf, type_traits<T>::tie(value), sequence(type_traits<T>::tie(value)));
+        return value;
+      }
+
+      static T null() {
+        return T();
+      }
+
+    private:
+
+      template<typename... F>
+      static typename internal::make_index_sequence<sizeof...(F)>::type sequence(const std::tuple<F&...> &) {
+        return typename internal::make_index_sequence<sizeof...(F)>::type();
+      }
+    };
+
+    /**
+     * Anonymous records, such as `SELECT ROW(1, 'one')`, are read into a
+     * std::tuple. The server does not accept anonymous records as parameters.
+     **/
+    template<typename... F>
+    struct type_traits<std::tuple<F...>> : composite_type_traits<std::tuple<F...>> {
+      static const Oid oid = RECORDOID;
+      static const Oid arrayOid = RECORDARRAYOID;
+
+      static std::tuple<F&...> tie(std::tuple<F...> &value) {
+        return tie(value, typename internal::make_index_sequence<sizeof...(F)>::type());
+      }
+
+    private:
+
+      template<size_t... I>
+      static std::tuple<F&...> tie(std::tuple<F...> &value, internal::index_sequence<I...>) {
+        return std::tuple<F&...>(std::get<I>(value)...);
+      }
+    };
+
   } // namespace postgres
 }   // namespace db
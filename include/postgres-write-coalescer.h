@@ -0,0 +1,231 @@
+/**
+ * Copyright (c) 2016 Philippe FERDINAND
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ **/
+#pragma once
+
+#include "postgres-connection.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+namespace db {
+  namespace postgres {
+
+    /**
+     * Group the rows written by concurrent threads into shared transactions.
+     *
+     * Rows are pushed by any thread into a lock-free queue and written by a
+     * background thread in batches: all the rows queued when a batch starts
+     * are inserted by a single statement in a single transaction, sharing the
+     * round trips and the commit of the batch. The statement receives one
+     * array per column, typically to be expanded by `unnest`:
+     *
+     * ```
+     * WriteCoalescer<int32_t, std::string> events(cnx,
+     *   "INSERT INTO events (id, name) SELECT * FROM unnest($1::int[], $2::text[])");
+     *
+     * // On any thread
+     * events.insert(42, "login").get(); // Wait for the commit.
+     * ```
+     *
+     * A batch starts every `interval` or as soon as `maxRows` rows are
+     * queued. The future returned by insert() is ready once the transaction
+     * of the row is committed, or holds the exception of the batch if the
+     * transaction failed.
+     *
+     * The transactions are executed by a background thread: the connection
+     * must not be used elsewhere until the coalescer is destroyed. The types
+     * of the columns must be bindable as arrays (see Params).
+     **/
+    template<typename... Columns>
+    class WriteCoalescer {
+    public:
+
+      /**
+       * Constructor.
+       *
+       * @param cnx      The connection used to write the rows.
+       * @param sql      The statement, taking one array per column.
+       * @param maxRows  Number of queued rows starting a batch.
+       * @param interval Maximum time between two batches.
+       **/
+      WriteCoalescer(Connection &cnx, const char *sql, size_t maxRows = 1024,
+                     std::chrono::microseconds interval = std::chrono::microseconds(1000))
+      : cnx_(cnx), sql_(sql), maxRows_(maxRows), interval_(interval),
+        head_(nullptr), size_(0), stop_(false) {
+        assert(maxRows_ > 0);
+        thread_ = std::thread(&WriteCoalescer::loop, this);
+      }
+
+      /**
+       * Destructor.
+       *
+       * The queued rows are written before the destructor returns.
+       **/
+      ~WriteCoalescer() {
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          stop_ = true;
+        }
+        wakeup_.notify_one();
+        thread_.join();
+      }
+
+      /**
+       * Queue a row.
+       *
+       * @param values The values of the columns.
+       * @return A future ready once the row is committed.
+       **/
+      std::future<void> insert(Columns... values) {
+        Node *node = new Node(std::move(values)...);
+        std::future<void> future = node->promise.get_future();
+
+        node->next = head_.load(std::memory_order_relaxed);
+        while (!head_.compare_exchange_weak(node->next, node,
+                                            std::memory_order_release,
+                                            std::memory_order_relaxed)) {
+        }
+        if (size_.fetch_add(1) + 1 == maxRows_) {
+          wakeup_.notify_one();
+        }
+        return future;
+      }
+
+    private:
+
+      /**
+       * A queued row.
+       **/
+      struct Node {
+        Node(Columns&&... values): row(std::move(values)...) {}
+
+        std::tuple<Columns...> row;
+        std::promise<void>     promise;
+        Node                  *next;
+      };
+
+      Connection               &cnx_;
+      std::string               sql_;
+      size_t                    maxRows_;
+      std::chrono::microseconds interval_;
+
+      std::atomic<Node *>       head_;    /**< Rows queued, last first. **/
+      std::atomic<size_t>       size_;    /**< Number of rows queued. **/
+
+      std::mutex                mutex_;   /**< Protect stop_. **/
+      std::condition_variable   wakeup_;  /**< Signal a full batch or stop. **/
+      bool                      stop_;
+      std::thread               thread_;
+
+      /**
+       * Main loop of the background thread.
+       **/
+      void loop() {
+        bool stop = false;
+        while (!stop) {
+          {
+            // insert() does not take the mutex: a missed notification only
+            // delays the batch until the end of the interval.
+            std::unique_lock<std::mutex> lock(mutex_);
+            wakeup_.wait_for(lock, interval_, [&] {
+              return stop_ || size_.load() >= maxRows_;
+            });
+            stop = stop_;
+          }
+          flush();
+        }
+      }
+
+      /**
+       * Write all the queued rows in a transaction.
+       **/
+      void flush() {
+        Node *node = head_.exchange(nullptr, std::memory_order_acquire);
+        if (node == nullptr) {
+          return;
+        }
+
+        // Restore the order of insertion.
+        std::vector<Node *> batch;
+        for (; node; node = node->next) {
+          batch.push_back(node);
+        }
+        size_.fetch_sub(batch.size());
+        std::reverse(batch.begin(), batch.end());
+
+        try {
+          cnx_.begin();
+          try {
+            write(batch, typename internal::make_index_sequence<sizeof...(Columns)>::type());
+          }
+          catch (...) {
+            cnx_.rollback();
+            throw;
+          }
+          cnx_.commit();
+          for (Node *node: batch) {
+            node->promise.set_value();
+          }
+        }
+        catch (...) {
+          std::exception_ptr error = std::current_exception();
+          for (Node *node: batch) {
+            node->promise.set_exception(error);
+          }
+        }
+
+        for (Node *node: batch) {
+          delete node;
+        }
+      }
+
+      /**
+       * Execute the statement with one array per column.
+       **/
+      template<size_t... I>
+      void write(const std::vector<Node *> &batch, internal::index_sequence<I...>) {
+        std::tuple<std::vector<Columns>...> columns;
+        int expand[] = { 0, (std::get<I>(columns).reserve(batch.size()), 0)... };
+        for (Node *node: batch) {
+          int expand[] = { 0, (std::get<I>(columns).push_back(std::move(std::get<I>(node->row))), 0)... };
+          (void)expand;
+        }
+        (void)expand;
+        cnx_.execute(sql_.c_str(), std::get<I>(columns)...);
+      }
+
+      WriteCoalescer(const WriteCoalescer&) = delete;
+      WriteCoalescer& operator = (const WriteCoalescer&) = delete;
+    };
+
+  } // namespace postgres
+}   // namespace db
@@ -0,0 +1,58 @@
+/**
+ * Copyright (c) 2016 Philippe FERDINAND
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ **/
+#include "postgres-catalog.h"
+
+namespace db {
+  namespace postgres {
+
+    // -------------------------------------------------------------------------
+    // Find a type already loaded in the catalog.
+    // -------------------------------------------------------------------------
+    const TypeInfo *TypeCatalog::find(const std::string &name) const {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto type = names_.find(name);
+      return type == names_.end() ? nullptr : type->second.get();
+    }
+
+    const TypeInfo *TypeCatalog::find(Oid oid) const {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto type = oids_.find(oid);
+      return type == oids_.end() ? nullptr : type->second.get();
+    }
+
+    // -------------------------------------------------------------------------
+    // Add a type loaded from the database.
+    // -------------------------------------------------------------------------
+    const TypeInfo &TypeCatalog::add(const std::string &name, TypeInfo &&type) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto &byOid = oids_[type.oid];
+      if (!byOid) {
+        byOid = std::make_shared<TypeInfo>(std::move(type));
+      }
+      if (!name.empty()) {
+        names_[name] = byOid;
+      }
+      return *byOid;
+    }
+
+  } // namespace postgres
+}   // namespace db
@@ -22,11 +22,20 @@
 #include "postgres-connection.h"
 #include "postgres-exceptions.h"
 
+#include <algorithm>
 #include <functional>
 #include <cassert>
+#include <cerrno>
 #include <string>
 #include <cstring>
 
+#ifdef _WIN32
+#include <winsock2.h>
+#define poll WSAPoll
+#else
+#include <poll.h>
+#endif
+
 #pragma comment(lib, "Ws2_32.lib")
 #pragma comment(lib, "Secur32.lib")
 
@@ -253,14 +262,21 @@ namespace db {
     Connection::Connection(Settings settings)
       : result_(*this) {
       pgconn_ = nullptr;
+      pgcancel_ = nullptr;
       transaction_ = 0;
       settings_ = settings;
+      timeout_ = settings_.timeout;
+      if (!settings_.types) {
+        settings_.types = std::make_shared<TypeCatalog>();
+      }
     }
 
     // -------------------------------------------------------------------------
     // Destructor.
     // -------------------------------------------------------------------------
     Connection::~Connection() {
+      result_.stopPrefetch();
+      PQfreeCancel(pgcancel_);
       PQfinish(pgconn_);
     }
     
@@ -276,6 +292,10 @@ namespace db {
         throw ConnectionException(std::string(PQerrorMessage(pgconn_)));
       }
 
+      pgcancel_ = PQgetCancel(pgconn_);
+      prepared_.clear();
+      parameters_.clear();
+      prepareStatements();
       return *this;
     }
     
@@ -284,11 +304,186 @@ namespace db {
     // -------------------------------------------------------------------------
     Connection &Connection::close() noexcept {
       assert(pgconn_);
+      result_.stopPrefetch();
+      PQfreeCancel(pgcancel_);
+      pgcancel_ = nullptr;
       PQfinish(pgconn_);
       pgconn_ = nullptr;
       return *this;
     }
 
+    // -------------------------------------------------------------------------
+    // Native connection ready for a new command.
+    // -------------------------------------------------------------------------
+    PGconn *Connection::idle() {
+      result_.clear();
+      return pgconn_;
+    }
+
+    // -------------------------------------------------------------------------
+    // Types resolved at runtime.
+    // -------------------------------------------------------------------------
+    static const char *TYPE_QUERY = R"SQL(
+      SELECT t.oid::bigint, t.typarray::bigint, t.typbasetype::bigint, t.typtype, t.typname::text,
+             ARRAY(SELECT e.enumlabel::text FROM pg_enum e
+                    WHERE e.enumtypid = t.oid ORDER BY e.enumsortorder)
+        FROM pg_type t
+    )SQL";
+
+    static TypeInfo readType(Result &result) {
+      TypeInfo type;
+      for (auto &row: result) {
+        type.oid = Oid(row.as<int64_t>(0));
+        type.arrayOid = Oid(row.as<int64_t>(1));
+        type.baseOid = Oid(row.as<int64_t>(2));
+        type.kind = row.as<char>(3);
+        type.name = row.as<std::string>(4);
+        for (auto &label: row.asArray<std::string>(5)) {
+          type.labels.push_back(label.value);
+        }
+      }
+      return type;
+    }
+
+    const TypeInfo &Connection::type(const char *name) {
+      const TypeInfo *type = settings_.types->find(name);
+      if (type) {
+        return *type;
+      }
+
+      TypeInfo info = readType(execute((std::string(TYPE_QUERY) + " WHERE t.oid = $1::text::regtype").c_str(), name));
+      return settings_.types->add(name, std::move(info));
+    }
+
+    const TypeInfo &Connection::type(Oid oid) {
+      const TypeInfo *type = settings_.types->find(oid);
+      if (type) {
+        return *type;
+      }
+
+      TypeInfo info = readType(execute((std::string(TYPE_QUERY) + " WHERE t.oid = $1::oid").c_str(), int64_t(oid)));
+      if (info.oid == 0) {
+        throw ExecutionException("Unknown type OID " + std::to_string(oid));
+      }
+      return settings_.types->add(std::string(), std::move(info));
+    }
+
+    // -------------------------------------------------------------------------
+    // Run-time parameters of the session.
+    // -------------------------------------------------------------------------
+    static std::string lowerCase(std::string name) {
+      std::transform(name.begin(), name.end(), name.begin(), [](char c) {
+        return c >= 'A' && c <= 'Z' ? char(c - 'A' + 'a') : c;
+      });
+      return name;
+    }
+
+    // PQparameterStatus() expects the names of the parameters reported by the
+    // server with their exact case.
+    static const char *reportedName(const std::string &name) {
+      if (name == "datestyle") {
+        return "DateStyle";
+      }
+      if (name == "intervalstyle") {
+        return "IntervalStyle";
+      }
+      if (name == "timezone") {
+        return "TimeZone";
+      }
+      return name.c_str();
+    }
+
+    const std::string *Connection::knownParameter(const std::string &name) {
+      // Parameters reported by the server are always up to date.
+      std::string key = lowerCase(name);
+      const char *reported = PQparameterStatus(pgconn_, reportedName(key));
+      if (reported) {
+        std::string &value = parameters_[key];
+        value = reported;
+        return &value;
+      }
+      auto it = parameters_.find(key);
+      return it == parameters_.end() ? nullptr : &it->second;
+    }
+
+    Connection &Connection::set(const std::vector<std::pair<std::string, std::string>> &parameters) {
+      std::string sql;
+      std::vector<const std::pair<std::string, std::string> *> changed;
+      for (auto &parameter: parameters) {
+        const std::string *current = knownParameter(parameter.first);
+        if (current && *current == parameter.second) {
+          continue;
+        }
+
+        char *name = PQescapeLiteral(pgconn_, parameter.first.c_str(), parameter.first.length());
+        char *value = PQescapeLiteral(pgconn_, parameter.second.c_str(), parameter.second.length());
+        if (name && value) {
+          sql += sql.empty() ? "SELECT " : ", ";
+          sql += std::string("set_config(") + name + ", " + value + ", false)";
+        }
+        PQfreemem(name);
+        PQfreemem(value);
+        if (!name || !value) {
+          throw ExecutionException(lastError());
+        }
+        changed.push_back(&parameter);
+      }
+
+      if (!changed.empty()) {
+        PQclear(executeBufferedParams(sql.c_str(), Params(*this, 0)));
+        for (auto parameter: changed) {
+          parameters_[lowerCase(parameter->first)] = parameter->second;
+        }
+      }
+      return *this;
+    }
+
+    static bool startsWith(const char *s, const char *prefix) {
+      return std::strncmp(s, prefix, std::strlen(prefix)) == 0;
+    }
+
+    void Connection::received(PGresult *pgresult) noexcept {
+      // The parameters not reported by the server are forgotten when a
+      // command may have changed them or a transaction setting them has been
+      // rolled back (COMMIT and ABORT of a failed transaction are reported as
+      // ROLLBACK).
+      switch (PQresultStatus(pgresult)) {
+        case PGRES_COMMAND_OK: {
+          const char *command = PQcmdStatus(pgresult);
+          if (startsWith(command, "SET") || startsWith(command, "RESET")
+              || startsWith(command, "DISCARD") || startsWith(command, "ROLLBACK")) {
+            parameters_.clear();
+          }
+          break;
+        }
+
+        case PGRES_BAD_RESPONSE:
+        case PGRES_FATAL_ERROR:
+          parameters_.clear();
+          break;
+
+        default:
+          break;
+      }
+    }
+
+    Connection &Connection::set(const std::string &name, const std::string &value) {
+      return set({ std::make_pair(name, value) });
+    }
+
+    std::string Connection::parameter(const std::string &name) {
+      const std::string *value = knownParameter(name);
+      if (value) {
+        return *value;
+      }
+      std::string current;
+      for (auto &row: execute("SELECT current_setting($1)", name)) {
+        current = row.as<std::string>(0);
+      }
+      parameters_[lowerCase(name)] = current;
+      return current;
+    }
+
     // -------------------------------------------------------------------------
     // Last error message on the connection.
     // -------------------------------------------------------------------------
@@ -299,9 +494,10 @@ namespace db {
     // -------------------------------------------------------------------------
     // Execute an SQL statement.
     // -------------------------------------------------------------------------
-    void Connection::execute(const char *sql, const Params &params) {
+    void Connection::executeParams(const char *sql, const Params &params) {
 
       result_.clear();
+      startTimeout();
 
       int success;
       if (isSingleStatement(sql)) {
@@ -329,6 +525,263 @@ namespace db {
       }
     }
 
+    // -------------------------------------------------------------------------
+    // Execute an SQL statement and load all the rows in memory.
+    // -------------------------------------------------------------------------
+    PGresult *Connection::executeBufferedParams(const char *sql, const Params &params) {
+
+      result_.clear();
+      startTimeout();
+
+      int success = PQsendQueryParams(pgconn_, sql, int(params.values_.size()),
+                                      params.types_.data(),
+                                      params.values_.data(),
+                                      params.lengths_.data(),
+                                      params.formats_.data(),
+                                      1 /* binary results */);
+      if (!success) {
+        throw ExecutionException(lastError());
+      }
+
+      return lastResult();
+    }
+
+    // -------------------------------------------------------------------------
+    // Wait for the last result of the current command.
+    // -------------------------------------------------------------------------
+    PGresult *Connection::lastResult() {
+      PGresult *pgresult = nullptr;
+      try {
+        while (PGresult *next = getResult()) {
+          PQclear(pgresult);
+          pgresult = next;
+        }
+      }
+      catch (...) {
+        PQclear(pgresult);
+        throw;
+      }
+
+      switch (PQresultStatus(pgresult)) {
+        case PGRES_TUPLES_OK:
+        case PGRES_COMMAND_OK:
+          return pgresult;
+
+        default:
+          PQclear(pgresult);
+          throw ExecutionException(lastError());
+      }
+    }
+
+    // -------------------------------------------------------------------------
+    // Prepare a statement.
+    // -------------------------------------------------------------------------
+    Connection &Connection::prepare(const char *name, const char *sql, const std::vector<Oid> &types) {
+
+      result_.clear();
+      startTimeout();
+
+      if (!PQsendPrepare(pgconn_, name, sql, int(types.size()), types.data())) {
+        throw ExecutionException(lastError());
+      }
+      PQclear(lastResult());
+
+      if (!PQsendDescribePrepared(pgconn_, name)) {
+        throw ExecutionException(lastError());
+      }
+      PGresult *pgresult = lastResult();
+      described(name, pgresult);
+      PQclear(pgresult);
+      return *this;
+    }
+
+    void Connection::described(const std::string &name, const PGresult *pgresult) {
+      std::vector<Oid> types(size_t(PQnparams(pgresult)));
+      for (size_t i = 0; i < types.size(); i++) {
+        types[i] = PQparamtype(pgresult, int(i));
+      }
+      prepared_[name] = std::move(types);
+    }
+
+    // -------------------------------------------------------------------------
+    // Prepare the statements of the registry.
+    // -------------------------------------------------------------------------
+    #ifdef LIBPQ_HAS_PIPELINING
+    void Connection::exitPipeline(bool synced) noexcept {
+      // The results are discarded up to the synchronization point, which is
+      // sent first if it was not.
+      // The connection may also be lost, and two consecutive nullptr mean
+      // that no command is left in the pipeline.
+      if (synced || PQpipelineSync(pgconn_)) {
+        bool end = false;
+        while (PQstatus(pgconn_) == CONNECTION_OK) {
+          PGresult *pgresult = PQgetResult(pgconn_);
+          if (pgresult == nullptr) {
+            if (end) {
+              break;
+            }
+            end = true;
+            continue;
+          }
+          end = false;
+          ExecStatusType status = PQresultStatus(pgresult);
+          PQclear(pgresult);
+          if (status == PGRES_PIPELINE_SYNC) {
+            break;
+          }
+        }
+      }
+      PQexitPipelineMode(pgconn_);
+    }
+    #endif
+
+    void Connection::prepareStatements() {
+      if (!settings_.statements) {
+        return;
+      }
+      std::vector<std::shared_ptr<const Statement>> statements = settings_.statements->statements();
+      if (statements.empty()) {
+        return;
+      }
+
+    #ifdef LIBPQ_HAS_PIPELINING
+      // All the statements are prepared and described in a single pipeline:
+      // the results are received once all the commands have been sent.
+      if (!PQenterPipelineMode(pgconn_)) {
+        throw ExecutionException(lastError());
+      }
+
+      bool synced = false;
+      std::string error;
+      try {
+        for (auto &statement: statements) {
+          if (!PQsendPrepare(pgconn_, statement->name.c_str(), statement->sql.c_str(),
+                             int(statement->types.size()), statement->types.data())
+              || !PQsendDescribePrepared(pgconn_, statement->name.c_str())) {
+            throw ExecutionException(lastError());
+          }
+        }
+        if (!PQpipelineSync(pgconn_)) {
+          throw ExecutionException(lastError());
+        }
+        synced = true;
+
+        // Each command has one result followed by nullptr. Once a command has
+        // failed the next ones are aborted until the synchronization point.
+        for (auto &statement: statements) {
+          for (int command = 0; command < 2; command++) {
+            PGresult *pgresult = PQgetResult(pgconn_);
+            if (pgresult == nullptr) {
+              // The connection has been lost.
+              throw ExecutionException(lastError());
+            }
+            switch (PQresultStatus(pgresult)) {
+              case PGRES_COMMAND_OK:
+                if (command == 1) {
+                  try {
+                    described(statement->name, pgresult);
+                  }
+                  catch (...) {
+                    PQclear(pgresult);
+                    throw;
+                  }
+                }
+                break;
+
+              case PGRES_PIPELINE_ABORTED:
+                break;
+
+              default:
+                if (error.empty()) {
+                  error = PQresultErrorMessage(pgresult);
+                }
+                break;
+            }
+            PQclear(pgresult);
+            discard();
+          }
+        }
+      }
+      catch (...) {
+        exitPipeline(synced);
+        throw;
+      }
+      exitPipeline(true);
+
+      if (!error.empty()) {
+        throw ExecutionException(error);
+      }
+    #else
+      for (auto &statement: statements) {
+        prepare(statement->name.c_str(), statement->sql.c_str(), statement->types);
+      }
+    #endif
+    }
+
+    // -------------------------------------------------------------------------
+    // Execute a prepared statement.
+    // -------------------------------------------------------------------------
+    void Connection::executePreparedParams(const char *name, Params &params) {
+
+      auto statement = prepared_.find(name);
+      if (statement == prepared_.end()) {
+        // A statement declared once the connection was opened.
+        std::shared_ptr<const Statement> declared;
+        if (settings_.statements) {
+          declared = settings_.statements->find(name);
+        }
+        if (!declared) {
+          throw ExecutionException(std::string("Unknown prepared statement ") + name);
+        }
+        prepare(name, declared->sql.c_str(), declared->types);
+        statement = prepared_.find(name);
+      }
+      params.convert(statement->second);
+
+      result_.clear();
+      startTimeout();
+
+      int success = PQsendQueryPrepared(pgconn_, name, int(params.values_.size()),
+                                        params.values_.data(),
+                                        params.lengths_.data(),
+                                        params.formats_.data(),
+                                        1 /* binary results */);
+      if (success) {
+        // Switch to the single row mode to avoid loading the all result in memory.
+        success = PQsetSingleRowMode(pgconn_);
+        assert(success);
+        result_.first();
+      }
+
+      if (!success) {
+        throw ExecutionException(lastError());
+      }
+    }
+
+    // -------------------------------------------------------------------------
+    // Execute a query shared with the identical ones in progress.
+    // -------------------------------------------------------------------------
+    std::shared_ptr<const BufferedResult> Connection::executeSharedParams(const char *sql, const Params &params) {
+      auto query = [&] {
+        return std::shared_ptr<const BufferedResult>(new BufferedResult(executeBufferedParams(sql, params)));
+      };
+      if (!settings_.flights) {
+        return query();
+      }
+
+      // Connections to another database, as another user or with another
+      // search_path (when reported by the server) do not share their queries.
+      const char *parts[] = { PQhost(pgconn_), PQport(pgconn_), PQdb(pgconn_), PQuser(pgconn_),
+                              PQparameterStatus(pgconn_, "session_authorization"),
+                              PQparameterStatus(pgconn_, "search_path") };
+      std::string scope;
+      for (const char *part: parts) {
+        scope.append(part ? part : "");
+        scope.push_back('\0');
+      }
+      return settings_.flights->execute(params.key(scope, sql), query);
+    }
+
     // -------------------------------------------------------------------------
     // Start a transaction.
     // -------------------------------------------------------------------------
@@ -363,17 +816,128 @@ namespace db {
     // Cancel queries in progress.
     // -------------------------------------------------------------------------
     Connection &Connection::cancel() {
-      char errbuf[256];
-      PGcancel *pgcancel = PQgetCancel(pgconn_);
+      if (pgcancel_ == nullptr) {
+        throw ExecutionException("The connection is not open.");
+      }
 
-      int success = PQcancel(pgcancel, errbuf, sizeof(errbuf));
-      if (!success) {
+      char errbuf[256];
+      if (!PQcancel(pgcancel_, errbuf, sizeof(errbuf))) {
         throw ExecutionException(errbuf);
       }
+      return *this;
+    }
+
+    // -------------------------------------------------------------------------
+    // Discard the pending results of the current command.
+    // -------------------------------------------------------------------------
+    void Connection::discard() noexcept {
+      while (PGresult *pgresult = PQgetResult(pgconn_)) {
+        received(pgresult);
+        PQclear(pgresult);
+      }
+    }
 
-      PQfreeCancel(pgcancel);
+    // -------------------------------------------------------------------------
+    // Timeout of the commands.
+    // -------------------------------------------------------------------------
+    Connection &Connection::timeout(std::chrono::milliseconds timeout) noexcept {
+      timeout_ = timeout;
       return *this;
     }
 
+    std::chrono::milliseconds Connection::timeout() const noexcept {
+      return timeout_;
+    }
+
+    void Connection::startTimeout() noexcept {
+      deadline_ = std::chrono::steady_clock::now() + timeout_;
+    }
+
+    // -------------------------------------------------------------------------
+    // Wait until a result can be read without blocking.
+    // Returns 1 when it can, 0 if the deadline has passed and -1 if the socket
+    // cannot be polled (see errno).
+    // -------------------------------------------------------------------------
+    int Connection::waitResult(std::chrono::steady_clock::time_point deadline) {
+      while (PQisBusy(pgconn_)) {
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+          deadline - std::chrono::steady_clock::now() + std::chrono::microseconds(999));
+        if (remaining.count() <= 0) {
+          return 0;
+        }
+
+        pollfd fd;
+        fd.fd = PQsocket(pgconn_);
+        fd.events = POLLIN;
+        fd.revents = 0;
+        int ready = poll(&fd, 1, int(remaining.count()));
+        if (ready < 0 && errno == EINTR) {
+          continue;
+        }
+        if (ready < 0) {
+          return -1;
+        }
+        if (ready > 0 && !PQconsumeInput(pgconn_)) {
+          throw ExecutionException(lastError());
+        }
+      }
+      return 1;
+    }
+
+    // -------------------------------------------------------------------------
+    // Cancel the current command and discard its pending results.
+    // Returns false if the connection had to be closed.
+    // -------------------------------------------------------------------------
+    bool Connection::abandon() noexcept {
+      try {
+        cancel();
+      }
+      catch (ExecutionException &) {
+        // The command may still complete within the grace period.
+      }
+
+      // The server answers the cancel request with an error result, which is
+      // waited for as long as the timeout of the command. If it does not come,
+      // the connection cannot be used for the next command and is closed.
+      auto grace = std::chrono::steady_clock::now() + timeout_;
+      try {
+        while (waitResult(grace) > 0) {
+          PGresult *pgresult = PQgetResult(pgconn_);
+          if (pgresult == nullptr) {
+            return true;
+          }
+          received(pgresult);
+          PQclear(pgresult);
+        }
+      }
+      catch (ExecutionException &) {
+      }
+      close();
+      return false;
+    }
+
+    // -------------------------------------------------------------------------
+    // Wait for the next result of the current command.
+    // -------------------------------------------------------------------------
+    PGresult *Connection::getResult() {
+      if (timeout_.count() > 0) {
+        int ready = waitResult(deadline_);
+        if (ready <= 0) {
+          std::string error = ready < 0 ? std::strerror(errno) : std::string();
+          std::string closed = abandon() ? "" : " The connection has been closed.";
+          if (ready < 0) {
+            throw ExecutionException(error + "." + closed);
+          }
+          throw TimeoutException("The command did not complete within " +
+                                 std::to_string(timeout_.count()) + "ms." + closed);
+        }
+      }
+      PGresult *pgresult = PQgetResult(pgconn_);
+      if (pgresult) {
+        received(pgresult);
+      }
+      return pgresult;
+    }
+
   } // namespace postgres
 }   // namespace db
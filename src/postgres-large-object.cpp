@@ -0,0 +1,219 @@
+/**
+ * Copyright (c) 2016 Philippe FERDINAND
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ **/
+#include "postgres-large-object.h"
+#include "postgres-exceptions.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace db {
+  namespace postgres {
+
+    // Largest number of bytes sent or received in one call.
+    static const size_t MAX_CHUNK = size_t(1) << 30;
+
+    // -------------------------------------------------------------------------
+    // Create and delete large objects.
+    // -------------------------------------------------------------------------
+    Oid LargeObject::create(Connection &conn, Oid oid) {
+      Oid created = lo_create(conn.idle(), oid);
+      if (created == InvalidOid) {
+        throw ExecutionException(conn.lastError());
+      }
+      return created;
+    }
+
+    void LargeObject::unlink(Connection &conn, Oid oid) {
+      if (lo_unlink(conn.idle(), oid) < 0) {
+        throw ExecutionException(conn.lastError());
+      }
+    }
+
+    // -------------------------------------------------------------------------
+    // Constructor.
+    // -------------------------------------------------------------------------
+    LargeObject::LargeObject(Connection &conn, Oid oid, Mode mode, size_t bufferSize)
+    : conn_(conn), oid_(oid), buffer_(std::max(std::min(bufferSize, MAX_CHUNK), size_t(1))),
+      begin_(0), end_(0), writing_(false) {
+      fd_ = lo_open(conn.idle(), oid, int(mode));
+      if (fd_ < 0) {
+        throw ExecutionException(conn.lastError());
+      }
+    }
+
+    // -------------------------------------------------------------------------
+    // Destructor.
+    // -------------------------------------------------------------------------
+    LargeObject::~LargeObject() {
+      if (fd_ >= 0) {
+        try {
+          close();
+        }
+        catch (...) {
+        }
+      }
+    }
+
+    // -------------------------------------------------------------------------
+    // Read from the large object.
+    // -------------------------------------------------------------------------
+    size_t LargeObject::read(char *buf, size_t size) {
+      assert(fd_ >= 0);
+      flush();
+
+      size_t total = 0;
+      while (total < size) {
+        if (begin_ == end_) {
+          int length;
+          if (size - total >= buffer_.size()) {
+            // Large reads go directly to the caller's buffer.
+            length = lo_read(conn_, fd_, buf + total, std::min(size - total, MAX_CHUNK));
+            check(length);
+            total += size_t(length);
+          }
+          else {
+            length = lo_read(conn_, fd_, buffer_.data(), buffer_.size());
+            check(length);
+            begin_ = 0;
+            end_ = size_t(length);
+          }
+          if (length == 0) {
+            break; // end of the large object
+          }
+        }
+        size_t length = std::min(size - total, end_ - begin_);
+        std::memcpy(buf + total, buffer_.data() + begin_, length);
+        begin_ += length;
+        total += length;
+      }
+      return total;
+    }
+
+    // -------------------------------------------------------------------------
+    // Write to the large object.
+    // -------------------------------------------------------------------------
+    void LargeObject::write(const char *buf, size_t size) {
+      assert(fd_ >= 0);
+      if (!writing_) {
+        discard();
+      }
+      if (end_ + size > buffer_.size()) {
+        flush();
+      }
+      if (size >= buffer_.size()) {
+        // Large writes are sent directly from the caller's buffer.
+        while (size > 0) {
+          int length = lo_write(conn_, fd_, buf, std::min(size, MAX_CHUNK));
+          check(length);
+          buf += length;
+          size -= size_t(length);
+        }
+        return;
+      }
+      std::memcpy(buffer_.data() + end_, buf, size);
+      end_ += size;
+      writing_ = true;
+    }
+
+    // -------------------------------------------------------------------------
+    // Move the current position.
+    // -------------------------------------------------------------------------
+    int64_t LargeObject::seek(int64_t offset, int whence) {
+      assert(fd_ >= 0);
+      if (whence == SEEK_CUR && !writing_) {
+        // The position of the server is after the unread data.
+        offset -= int64_t(end_ - begin_);
+        begin_ = end_ = 0;
+      }
+      else {
+        discard();
+      }
+      int64_t position = lo_lseek64(conn_, fd_, offset, whence);
+      check(position);
+      return position;
+    }
+
+    int64_t LargeObject::tell() {
+      assert(fd_ >= 0);
+      int64_t position = lo_tell64(conn_, fd_);
+      check(position);
+      return writing_ ? position + int64_t(end_ - begin_) : position - int64_t(end_ - begin_);
+    }
+
+    // -------------------------------------------------------------------------
+    // Truncate or extend the large object.
+    // -------------------------------------------------------------------------
+    void LargeObject::truncate(int64_t size) {
+      assert(fd_ >= 0);
+      discard();
+      check(lo_truncate64(conn_, fd_, size));
+    }
+
+    // -------------------------------------------------------------------------
+    // Send the pending writes.
+    // -------------------------------------------------------------------------
+    void LargeObject::flush() {
+      if (writing_) {
+        while (begin_ < end_) {
+          int length = lo_write(conn_, fd_, buffer_.data() + begin_, end_ - begin_);
+          check(length);
+          begin_ += size_t(length);
+        }
+        begin_ = end_ = 0;
+        writing_ = false;
+      }
+    }
+
+    // -------------------------------------------------------------------------
+    // Close the large object.
+    // -------------------------------------------------------------------------
+    void LargeObject::close() {
+      assert(fd_ >= 0);
+      flush();
+      int result = lo_close(conn_, fd_);
+      fd_ = -1;
+      check(result);
+    }
+
+    // -------------------------------------------------------------------------
+    // Empty the buffer, moving the position of the server back to the current
+    // position if there is unread data.
+    // -------------------------------------------------------------------------
+    void LargeObject::discard() {
+      if (writing_) {
+        flush();
+      }
+      else if (begin_ < end_) {
+        check(lo_lseek64(conn_, fd_, -int64_t(end_ - begin_), SEEK_CUR));
+      }
+      begin_ = end_ = 0;
+    }
+
+    void LargeObject::check(int64_t result) {
+      if (result < 0) {
+        throw ExecutionException(conn_.lastError());
+      }
+    }
+
+  } // namespace postgres
+}   // namespace db
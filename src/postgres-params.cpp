@@ -32,8 +32,8 @@ namespace db {
     //--------------------------------------------------------------------------
     // Constructor
     //--------------------------------------------------------------------------
-    Params::Params(const Settings &settings, int size)
-    : settings_(settings) {
+    Params::Params(Connection &conn, int size)
+    : conn_(conn) {
       types_.reserve(size);
       values_.reserve(size);
       lengths_.reserve(size);
@@ -46,16 +46,150 @@ namespace db {
       }
     }
 
-    template <typename T>
-    char *write(T value, char *buf);
+    bool Params::emptyStringAsNull() const noexcept {
+      return conn_.settings_.emptyStringAsNull;
+    }
+
+    const TypeInfo &Params::type(const char *name) {
+      return conn_.type(name);
+    }
 
     char *Params::bind(Oid type, size_t length) {
+      char *buf = buffer(length);
+      bind(type, buf, length);
+      return buf;
+    }
+
+    char *Params::buffer(size_t length) {
       char *buf = new char[length];
       buffers_.push_back(buf);
-      bind(type, buf, length);
       return buf;
     }
 
+    //--------------------------------------------------------------------------
+    // Convert the parameters to the types of a prepared statement.
+    //--------------------------------------------------------------------------
+    template<typename T>
+    void Params::replace(size_t index, Oid type, const T &value) {
+      int32_t length = type_traits<T>::length(value);
+      char *buf = buffer(size_t(length));
+      type_traits<T>::write(value, buf);
+      types_[index] = type;
+      values_[index] = buf;
+      lengths_[index] = length;
+    }
+
+    void Params::replaceText(size_t index, Oid type, const char *text, size_t length) {
+      // Values in text format are null-terminated strings.
+      char *buf = buffer(length + 1);
+      std::memcpy(buf, text, length);
+      buf[length] = '\0';
+      types_[index] = type;
+      values_[index] = buf;
+      lengths_[index] = int(length);
+      formats_[index] = 0;
+    }
+
+    static bool isInteger(Oid type) {
+      return type == INT2OID || type == INT4OID || type == INT8OID;
+    }
+
+    void Params::convert(const std::vector<Oid> &targets) {
+      if (targets.size() != types_.size()) {
+        throw ExecutionException("The prepared statement expects " + std::to_string(targets.size()) +
+                                 " parameters, " + std::to_string(types_.size()) + " given.");
+      }
+
+      for (size_t i = 0; i < types_.size(); i++) {
+        Oid from = types_[i];
+        Oid to = targets[i];
+        if (values_[i] == nullptr || from == to || to == 0) {
+          continue;
+        }
+
+        if (isInteger(from)) {
+          int64_t value = from == INT2OID ? read_value<int16_t>(values_[i], lengths_[i])
+                        : from == INT4OID ? read_value<int32_t>(values_[i], lengths_[i])
+                        : read_value<int64_t>(values_[i], lengths_[i]);
+          if ((to == INT2OID && int16_t(value) != value) || (to == INT4OID && int32_t(value) != value)) {
+            throw ExecutionException("Parameter $" + std::to_string(i + 1) + " is out of range for its type.");
+          }
+          switch (to) {
+            case INT2OID:   replace(i, to, int16_t(value)); continue;
+            case INT4OID:   replace(i, to, int32_t(value)); continue;
+            case INT8OID:   replace(i, to, value); continue;
+            case FLOAT4OID: replace(i, to, float(value)); continue;
+            case FLOAT8OID: replace(i, to, double(value)); continue;
+            case NUMERICOID: {
+              std::string text = std::to_string(value);
+              replaceText(i, to, text.c_str(), text.length());
+              continue;
+            }
+          }
+        }
+        else if (from == FLOAT4OID && to == FLOAT8OID) {
+          replace(i, to, double(read_value<float>(values_[i], lengths_[i])));
+          continue;
+        }
+        else if (from == VARCHAROID) {
+          switch (to) {
+            case TEXTOID:
+            case BPCHAROID:
+            case NAMEOID:
+              types_[i] = to; // Same binary format.
+              continue;
+            case DATEOID:
+            case TIMESTAMPOID:
+              // ISO dates are parsed client side, others by the server.
+              try {
+                if (to == DATEOID) {
+                  replace(i, to, internal::text_reader<date_t>::read(values_[i], lengths_[i]));
+                }
+                else {
+                  replace(i, to, internal::text_reader<timestamp_t>::read(values_[i], lengths_[i]));
+                }
+                continue;
+              }
+              catch (ExecutionException &) {
+              }
+              replaceText(i, to, values_[i], size_t(lengths_[i]));
+              continue;
+            default:
+              // Parsed by the server, without the cast of a varchar.
+              replaceText(i, to, values_[i], size_t(lengths_[i]));
+              continue;
+          }
+        }
+
+        throw ExecutionException("Parameter $" + std::to_string(i + 1) + " of type " + std::to_string(from) +
+                                 " cannot be converted to type " + std::to_string(to) + ".");
+      }
+    }
+
+    //--------------------------------------------------------------------------
+    // Identify a query.
+    //--------------------------------------------------------------------------
+    std::string Params::key(const std::string &scope, const char *sql) const {
+      size_t size = scope.length() + std::strlen(sql) + 1;
+      for (size_t i = 0; i < values_.size(); i++) {
+        size += sizeof(Oid) + sizeof(int) + (values_[i] ? size_t(lengths_[i]) : 0);
+      }
+
+      std::string key;
+      key.reserve(size);
+      key.append(scope);
+      key.append(sql, std::strlen(sql) + 1);
+      for (size_t i = 0; i < values_.size(); i++) {
+        int length = values_[i] ? lengths_[i] : -1;
+        key.append(reinterpret_cast<const char *>(&types_[i]), sizeof(Oid));
+        key.append(reinterpret_cast<const char *>(&length), sizeof(int));
+        if (values_[i]) {
+          key.append(values_[i], size_t(length));
+        }
+      }
+      return key;
+    }
+
     //--------------------------------------------------------------------------
     // Bind any value
     //--------------------------------------------------------------------------
@@ -83,68 +217,11 @@ namespace db {
       bind(UNKNOWNOID, (char *)nullptr, 0);
     }
 
-    //--------------------------------------------------------------------------
-    // bool
-    //--------------------------------------------------------------------------
-    template<>
-    void Params::bind(bool b) {
-      write(b, bind(BOOLOID, sizeof(b)));
-    }
-
-    //--------------------------------------------------------------------------
-    // smallint
-    //--------------------------------------------------------------------------
-    template<>
-    void Params::bind(int16_t i) {
-      write(i, bind(INT2OID, sizeof(i)));
-    }
-
-    //--------------------------------------------------------------------------
-    // integer
-    //--------------------------------------------------------------------------
-    template<>
-    void Params::bind(int32_t i) {
-      write(i, bind(INT4OID, sizeof(i)));
-    }
-
-    //--------------------------------------------------------------------------
-    // bigint
-    //--------------------------------------------------------------------------
-    template<>
-    void Params::bind(int64_t i) {
-      write(i, bind(INT8OID, sizeof(i)));
-    }
-
-    //--------------------------------------------------------------------------
-    // float
-    //--------------------------------------------------------------------------
-    template<>
-    void Params::bind(float f) {
-      write(f, bind(FLOAT4OID, sizeof(f)));
-    }
-
-    //--------------------------------------------------------------------------
-    // double precision
-    //--------------------------------------------------------------------------
-    template<>
-    void Params::bind(double d) {
-      write(d, bind(FLOAT8OID, sizeof(d)));
-    }
-
-    //--------------------------------------------------------------------------
-    // "char"
-    //--------------------------------------------------------------------------
-    template<>
-    void Params::bind(char c) {
-      write(c, bind(CHAROID, sizeof(c)));
-    }
-
     //--------------------------------------------------------------------------
     // varchar
     //--------------------------------------------------------------------------
-    template<>
     void Params::bind(const char *sz) {
-      if (sz[0] == '\0' && settings_.emptyStringAsNull) {
+      if (sz[0] == '\0' && conn_.settings_.emptyStringAsNull) {
         bind(nullptr);
       }
       else {
@@ -153,7 +230,7 @@ namespace db {
     }
 
     void Params::bind(const std::string &s) {
-      if (s.length() == 0 && settings_.emptyStringAsNull) {
+      if (s.length() == 0 && conn_.settings_.emptyStringAsNull) {
         bind(nullptr);
       }
       else {
@@ -161,6 +238,7 @@ namespace db {
       }
     }
 
+
     //--------------------------------------------------------------------------
     // bytea
     //--------------------------------------------------------------------------
@@ -168,166 +246,8 @@ namespace db {
       bind(BYTEAOID, (char *)bytes.data(), bytes.size());
     }
 
-    //--------------------------------------------------------------------------
-    // date
-    //--------------------------------------------------------------------------
-    template<>
-    void Params::bind(date_t d) {
-      write(d, bind(DATEOID, sizeof(d)));
-    }
-
-    //--------------------------------------------------------------------------
-    // timestamptz
-    //--------------------------------------------------------------------------
-    template<>
-    void Params::bind(timestamptz_t d) {
-      write(d, bind(TIMESTAMPTZOID, sizeof(d)));
-    }
-
-    //--------------------------------------------------------------------------
-    // timestamp
-    //--------------------------------------------------------------------------
-    template<>
-    void Params::bind(timestamp_t d) {
-      write(d, bind(TIMESTAMPOID, sizeof(d)));
-    }
-
-    //--------------------------------------------------------------------------
-    // timetz
-    //--------------------------------------------------------------------------
-    template<>
-    void Params::bind(timetz_t t) {
-      write(t, bind(TIMETZOID, 12));
-    }
-
-    //--------------------------------------------------------------------------
-    // time
-    //--------------------------------------------------------------------------
-    template<>
-    void Params::bind(time_t t) {
-      write(t, bind(TIMEOID, sizeof(t)));
-    }
-
-    //--------------------------------------------------------------------------
-    // interval
-    //--------------------------------------------------------------------------
-    template<>
-    void Params::bind(interval_t t) {
-      assert(sizeof(t) == 16);
-      write(t, bind(INTERVALOID, sizeof(t)));
-    }
-
-    //--------------------------------------------------------------------------
-    // Arrays
-    //--------------------------------------------------------------------------
-
-    template<typename T>
-    void Params::bind(Oid arrayType, Oid elemType, const std::vector<array_item<T>> &array) {
-
-      // The value of the array should look like this:
-      //
-      // struct pg_array {
-      //   int32_t ndim; /* Number of dimensions */
-      //   int32_t ign;  /* offset for data, removed by libpq */
-      //   Oid elemtype; /* type of element in the array */
-      //
-      //   /* First dimension */
-      //   int32_t size;  /* Number of elements */
-      //   int32_t index; /* Index of first element */
-      //   T first_value; /* Beginning of the data */
-      // }
-
-      int32_t bufferSize = 5 * sizeof(int32_t); // array headers
-      for (auto &i: array) {
-        bufferSize += sizeof(int32_t);
-        if (!i.isNull) {
-          bufferSize += length(i.value);
-        }
-      }
-
-      char *buf = bind(arrayType, bufferSize);
-      buf = write(int32_t(1), buf);        /* Number of dimensions */
-      buf = write(int32_t(0), buf);        /* ignored */
-      buf = write(int32_t(elemType), buf); /* type of elements in the array */
-      buf = write(int32_t(array.size()), buf); /* Number of elements */
-      buf = write(int32_t(1), buf);            /* Index of first element */
-      for (auto &i: array) {
-        if (i.isNull
-            || (elemType == VARCHAROID
-                && settings_.emptyStringAsNull
-                && length(i.value) == 0)) {
-          buf = write(int32_t(-1), buf);
-        }
-        else {
-          buf = write(length(i.value), buf);
-          buf = write(i.value, buf);
-        }
-      }
-    }
-
-    template<>
-    void Params::bind(const std::vector<array_item<bool>> &array) {
-      bind(BOOLARRAYOID, BOOLOID, array);
-    }
-
-    template<>
-    void Params::bind(const std::vector<array_item<int16_t>> &array) {
-      bind(INT2ARRAYOID, INT2OID, array);
-    }
-
-    template<>
-    void Params::bind(const std::vector<array_item<int32_t>> &array) {
-      bind(INT4ARRAYOID, INT4OID, array);
-    }
-
-    template<>
-    void Params::bind(const std::vector<array_item<int64_t>> &array) {
-      bind(INT8ARRAYOID, INT8OID, array);
-    }
-
-    template<>
-    void Params::bind(const std::vector<array_item<float>> &array) {
-      bind(FLOAT4ARRAYOID, FLOAT4OID, array);
-    }
-
-    template<>
-    void Params::bind(const std::vector<array_item<double>> &array) {
-      bind(FLOAT8ARRAYOID, FLOAT8OID, array);
-    }
-
-    template<>
-    void Params::bind(const std::vector<array_item<std::string>> &array) {
-      bind(VARCHARARRAYOID, VARCHAROID, array);
-    }
-
-    template<>
-    void Params::bind(const std::vector<array_item<date_t>> &array) {
-      bind(DATEARRAYOID, DATEOID, array);
-    }
-
-    template<>
-    void Params::bind(const std::vector<array_item<time_t>> &array) {
-      bind(TIMEARRAYOID, TIMEOID, array);
-    }
-
-    template<>
-    void Params::bind(const std::vector<array_item<timetz_t>> &array) {
-      bind(TIMETZARRAYOID, TIMETZOID, array);
-    }
-
-    template<>
-    void Params::bind(const std::vector<array_item<timestamp_t>> &array) {
-      bind(TIMESTAMPARRAYOID, TIMESTAMPOID, array);
-    }
-
-    template<>
-    void Params::bind(const std::vector<array_item<timestamptz_t>> &array) {
-      bind(TIMESTAMPTZARRAYOID, TIMESTAMPTZOID, array);
-    }
-
-    template<>
-    void Params::bind(const std::vector<array_item<interval_t>> &array) {
-      bind(INTERVALARRAYOID, INTERVALOID, array);
+    void Params::bind(const bytea_view &bytes) {
+      bind(BYTEAOID, (char *)bytes.data, bytes.size);
     }
 
   } // namespace postgres
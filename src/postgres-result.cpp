@@ -23,319 +23,245 @@
 #include "postgres-connection.h"
 #include "postgres-exceptions.h"
 
+#include <atomic>
 #include <cassert>
+#include <condition_variable>
 #include <cstdlib>
 #include <cstring>
-#include <iostream>
+#include <mutex>
+#include <thread>
 
 namespace db {
   namespace postgres {
 
-#ifdef NDEBUG
-
-    #define assert_oid(expected, actual) ((void)0)
-
-#else
-
-    void assert_oid(int expected, int actual) {
-      const char *_expected = nullptr;
-      if (expected != UNKNOWNOID && expected != actual) {
-        switch (expected) {
-          case BOOLOID: _expected = "std::vector<uint_8>"; break;
-          case BYTEAOID: _expected = "char"; break;
-          case CHAROID: _expected = "std::string"; break;
-          case NAMEOID: _expected = "std::string"; break;
-          case INT8OID: _expected = "int64_t"; break;
-          case INT2OID: _expected = "int16_t"; break;
-          case INT4OID: _expected = "int32_t"; break;
-          case TEXTOID: _expected = "std::string"; break;
-          case FLOAT4OID: _expected = "float"; break;
-          case FLOAT8OID: _expected = "double"; break;
-          case BPCHAROID: _expected = "std::string"; break;
-          case VARCHAROID: _expected = "std::string"; break;
-          case DATEOID: _expected = "db::postgres::date_t"; break;
-          case TIMEOID: _expected = "db::postgres::time_t"; break;
-          case TIMESTAMPOID: _expected = "db::postgres::timestamp_t"; break;
-          case TIMESTAMPTZOID: _expected = "db::postgres::timestamptz_t"; break;
-          case INTERVALOID: _expected = "db::postgres::interval_t"; break;
-          case TIMETZOID: _expected = "db::postgres::timetz_t"; break;
-          default:
-            assert(false); // unsupported type. try std::string
-        }
-
-        std::cerr << "Unexpected C++ type. Please use as<" << _expected
-          << ">(int column)" << std::endl;
-        assert(false);
-      }
-    }
-#endif
-
-    // -------------------------------------------------------------------------
-    // Reading a value from a PGresult
-    // -------------------------------------------------------------------------
-    template <typename T>
-    T read(const PGresult *pgresult, int column) {
-      char *buf = PQgetvalue(pgresult, 0, column);
-      return read<T>(&buf);
-    }
-
-    template <typename T>
-    T read(const PGresult *pgresult, int oid, int column, T defVal) {
-      assert(pgresult != nullptr);
-      assert_oid(PQftype(pgresult, column), oid);
-      return PQgetisnull(pgresult, 0, column) ? defVal : read<T>(pgresult, column);
-    }
-
-    template<typename T>
-    std::vector<array_item<T>> readArray(const PGresult *pgresult, int oid, int column, T defVal) {
-      std::vector<array_item<T>> array;
-
-      if (!PQgetisnull(pgresult, 0, column)) {
-        // The data should look like this:
-        //
-        // struct pg_array {
-        //   int32_t ndim; /* Number of dimensions */
-        //   int32_t ign;  /* offset for data, removed by libpq */
-        //   Oid elemtype; /* type of element in the array */
-        //
-        //   /* First dimension */
-        //   int32_t size;  /* Number of elements */
-        //   int32_t index; /* Index of first element */
-        //   T first_value; /* Beginning of the data */
-        // }
-        char *buf = PQgetvalue(pgresult, 0, column);
-        int32_t ndim = read<int32_t>(&buf);
-        read<int32_t>(&buf); // skip
-        int32_t elemType = read<int32_t>(&buf);
-        assert_oid(oid, elemType);
-        assert(ndim == 1); // only array of 1 dimmension are supported so far.
-
-        // First dimension
-        int32_t size = read<int32_t>(&buf);
-        read<int32_t>(&buf); // skip the index of first element.
-
-        int32_t elemSize;
-        array.reserve(size);
-        for (int32_t i=0; i < size; i++) {
-          elemSize = read<int32_t>(&buf);
-          array_item<T> elem;
-          if (elemSize == -1) {
-            // null value
-            elem.isNull = true;
-            elem.value = defVal;
-          }
-          else {
-            elem.isNull = false;
-            elem.value = read<T>(&buf, elemSize);
-          }
-
-          array.push_back(std::move(elem));
-        }
-      }
-
-      return array;
-    }
-
     // -------------------------------------------------------------------------
     // Row contructor
     // -------------------------------------------------------------------------
-    Row::Row(Result &result)
-    : result_(result) {
+    Row::Row(PGresult *pgresult, int row, int num)
+    : pgresult_(pgresult), row_(row), num_(num) {
     }
 
     int Row::num() const noexcept {
-      return result_.num_;
+      return num_;
     }
 
     // -------------------------------------------------------------------------
     // Tests a column for a null value.
     // -------------------------------------------------------------------------
     bool Row::isNull(int column) const {
-      assert(result_.pgresult_ != nullptr);
-      return PQgetisnull(result_, 0, column) == 1;
+      assert(pgresult_ != nullptr);
+      return PQgetisnull(pgresult_, row_, column) == 1;
     }
 
     // -------------------------------------------------------------------------
     // Get a column name.
     // -------------------------------------------------------------------------
     const char *Row::columnName(int column) const {
-      assert(result_.pgresult_ != nullptr);
-      const char *res = PQfname(result_, column);
+      assert(pgresult_ != nullptr);
+      const char *res = PQfname(pgresult_, column);
       assert(res);
       return res;
     }
 
-    template<>
-    bool Row::as<bool>(int column) const {
-      return read<bool>(result_, BOOLOID, column, false);
-    }
-
-    template<>
-    int16_t Row::as<int16_t>(int column) const {
-      return read<int16_t>(result_, INT2OID, column, 0);
-    }
-
-    template<>
-    int32_t Row::as<int32_t>(int column) const {
-      return read<int32_t>(result_, INT4OID, column, 0);
-    }
-
-    template<>
-    int64_t Row::as<int64_t>(int column) const {
-      return read<int64_t>(result_, INT8OID, column, 0);
-    }
-
-    template<>
-    float Row::as<float>(int column) const {
-      return read<float>(result_, FLOAT4OID, column, 0.f);
-    }
-
-    template<>
-    double Row::as<double>(int column) const {
-      return read<double>(result_, FLOAT8OID, column, 0.);
-    }
+    // -------------------------------------------------------------------------
+    // Copy the row.
+    // -------------------------------------------------------------------------
+    RowSnapshot Row::snapshot() const {
+      assert(pgresult_ != nullptr);
+      const int columns = PQnfields(pgresult_);
+      if (!descriptor_) {
+        std::shared_ptr<RowDescriptor> descriptor = std::make_shared<RowDescriptor>();
+        descriptor->names.reserve(size_t(columns));
+        descriptor->types.reserve(size_t(columns));
+        descriptor->formats.reserve(size_t(columns));
+        for (int i = 0; i < columns; i++) {
+          descriptor->names.push_back(PQfname(pgresult_, i));
+          descriptor->types.push_back(PQftype(pgresult_, i));
+          descriptor->formats.push_back(PQfformat(pgresult_, i));
+        }
+        descriptor_ = descriptor;
+      }
 
-    template<>
-    std::string Row::as<std::string>(int column) const {
-      assert(result_.pgresult_ != nullptr);
-      if (PQgetisnull(result_, 0, column)) {
-        return std::string();
+      size_t size = size_t(columns) * (sizeof(int32_t) + sizeof(uint32_t));
+      for (int i = 0; i < columns; i++) {
+        size += size_t(PQgetlength(pgresult_, row_, i)) + 1;
       }
-      int length = PQgetlength(result_, 0, column);
-      char *buf  = PQgetvalue(result_, 0, column);
-      return read<std::string>(&buf, length);
-    }
 
-    // -------------------------------------------------------------------------
-    // "char"
-    // -------------------------------------------------------------------------
-    template<>
-    char Row::as<char>(int column) const {
-      assert(result_.pgresult_ != nullptr);
-      if (PQgetisnull(result_, 0, column)) {
-        return '\0';
+      RowSnapshot snapshot;
+      snapshot.descriptor_ = descriptor_;
+      snapshot.num_ = num_;
+      snapshot.data_.reset(new char[size]);
+
+      int32_t *lengths = reinterpret_cast<int32_t *>(snapshot.data_.get());
+      uint32_t *offsets = reinterpret_cast<uint32_t *>(lengths + columns);
+      char *values = reinterpret_cast<char *>(offsets + columns);
+      for (int i = 0; i < columns; i++) {
+        int32_t length = PQgetlength(pgresult_, row_, i);
+        lengths[i] = PQgetisnull(pgresult_, row_, i) ? -1 : length;
+        offsets[i] = uint32_t(values - snapshot.data_.get());
+        std::memcpy(values, PQgetvalue(pgresult_, row_, i), size_t(length));
+        values[length] = '\0';
+        values += length + 1;
       }
-      assert(PQgetlength(result_, 0, column) == 1);
-      return *PQgetvalue(result_, 0, column);
+      return snapshot;
     }
 
     // -------------------------------------------------------------------------
-    // bytea
+    // A bounded single-producer/single-consumer lock-free queue.
+    //
+    // push() and pop() only spin on the atomic indexes while the other side is
+    // making progress, and park the thread on a condition variable when the
+    // queue stays full (or empty), which is the case while waiting for the
+    // network.
     // -------------------------------------------------------------------------
-    template<>
-    std::vector<uint8_t> Row::as<std::vector<uint8_t>>(int column) const {
-      assert(result_.pgresult_ != nullptr);
-      assert_oid(PQftype(result_, column), BYTEAOID);
-      int length = PQgetlength(result_, 0, column);
-      uint8_t *data = reinterpret_cast<uint8_t *>(PQgetvalue(result_, 0, column));
-      return std::vector<uint8_t>(data, data + length);
-    }
-
-    template<>
-    date_t Row::as<date_t>(int column) const {
-      return read<date_t>(result_, DATEOID, column, date_t { 0 });
-    }
+    template <typename T>
+    class SpscQueue {
+    public:
+      SpscQueue(size_t capacity)
+      : items_(capacity + 1), head_(0), tail_(0), producerWaiting_(false),
+        consumerWaiting_(false) {
+      }
 
-    template<>
-    timestamptz_t Row::as<timestamptz_t>(int column) const {
-      return read<timestamptz_t>(result_, TIMESTAMPTZOID, column, timestamptz_t { 0 });
-    }
+      void push(T &&item) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        size_t next = (tail + 1) % items_.size();
+        wait(producerWaiting_, [&] { return next != head_.load(); });
+        items_[tail] = std::move(item);
+        tail_.store(next);
+        wake(consumerWaiting_);
+      }
 
-    template<>
-    timestamp_t Row::as<timestamp_t>(int column) const {
-      return read<timestamp_t>(result_, TIMESTAMPOID, column, timestamp_t { 0 });
-    }
+      T pop() {
+        size_t head = head_.load(std::memory_order_relaxed);
+        wait(consumerWaiting_, [&] { return head != tail_.load(); });
+        T item = std::move(items_[head]);
+        head_.store((head + 1) % items_.size());
+        wake(producerWaiting_);
+        return item;
+      }
 
-    template<>
-    timetz_t Row::as<timetz_t>(int column) const {
-      return read<timetz_t>(result_, TIMETZOID, column, timetz_t { 0, 0 });
-    }
+    private:
+      std::vector<T>          items_;
+      std::atomic<size_t>     head_;  /**< Next item to pop. **/
+      std::atomic<size_t>     tail_;  /**< Next item to push. **/
+      std::atomic<bool>       producerWaiting_;
+      std::atomic<bool>       consumerWaiting_;
+      std::mutex              mutex_;
+      std::condition_variable cv_;
+
+      template <typename Predicate>
+      void wait(std::atomic<bool> &waiting, Predicate ready) {
+        for (int i = 0; i < 64; i++) {
+          if (ready()) {
+            return;
+          }
+          std::this_thread::yield();
+        }
 
-    template<>
-    time_t Row::as<time_t>(int column) const {
-      return read<time_t>(result_, TIMEOID, column, time_t { 0 });
-    }
+        // Either the other side sees `waiting` or we see its progress, the
+        // atomics being sequentially consistent.
+        std::unique_lock<std::mutex> lock(mutex_);
+        waiting = true;
+        cv_.wait(lock, ready);
+        waiting = false;
+      }
 
-    template<>
-    interval_t Row::as<interval_t>(int column) const {
-      return read<interval_t>(result_, INTERVALOID, column, interval_t { 0, 0, 0 });
-    }
+      void wake(std::atomic<bool> &waiting) {
+        if (waiting) {
+          std::lock_guard<std::mutex> lock(mutex_);
+          cv_.notify_all();
+        }
+      }
+    };
 
     // -------------------------------------------------------------------------
-    // Arrays
+    // Receive the rows of a result on a background thread.
     // -------------------------------------------------------------------------
+    class Prefetcher {
+    public:
 
-    template<>
-    std::vector<array_item<bool>> Row::asArray(int column) const {
-      return readArray<bool>(result_, BOOLOID, column, 0);
-    }
-
-    template<>
-    std::vector<array_item<int16_t>> Row::asArray<int16_t>(int column) const {
-      return readArray<int16_t>(result_, INT2OID, column, 0);
-    }
-
-    template<>
-    std::vector<array_item<int32_t>> Row::asArray<int32_t>(int column) const {
-      return readArray<int32_t>(result_, INT4OID, column, 0);
-    }
-
-    template<>
-    std::vector<array_item<int64_t>> Row::asArray<int64_t>(int column) const {
-      return readArray<int64_t>(result_, INT8OID, column, 0);
-    }
-
-    template<>
-    std::vector<array_item<float>> Row::asArray<float>(int column) const {
-      return readArray<float>(result_, FLOAT4OID, column, 0.f);
-    }
-
-    template<>
-    std::vector<array_item<double>> Row::asArray<double>(int column) const {
-      return readArray<double>(result_, FLOAT8OID, column, 0.);
-    }
+      Prefetcher(PGconn *pgconn, PGcancel *pgcancel, int batchSize, int batches)
+      : pgconn_(pgconn), pgcancel_(pgcancel), queue_(size_t(batches)),
+        batchSize_(size_t(batchSize)), index_(0), done_(false), received_(false) {
+        thread_ = std::thread(&Prefetcher::run, this);
+      }
 
-    template<>
-    std::vector<array_item<date_t>> Row::asArray<date_t>(int column) const {
-      return readArray<date_t>(result_, DATEOID, column, date_t { 0 });
-    }
+      // -----------------------------------------------------------------------
+      // Stop receiving rows. The query is cancelled if it is still running.
+      // The rows are drained anyway, which also covers a failed cancel.
+      // -----------------------------------------------------------------------
+      ~Prefetcher() {
+        if (!done_) {
+          if (!received_) {
+            char errbuf[256];
+            PQcancel(pgcancel_, errbuf, sizeof(errbuf));
+          }
+          do {
+            PQclear(pop());
+          } while (!done_);
+        }
+        thread_.join();
+      }
 
-    template<>
-    std::vector<array_item<timestamptz_t>> Row::asArray<timestamptz_t>(int column) const {
-      return readArray<timestamptz_t>(result_, TIMESTAMPTZOID, column, timestamptz_t { 0 });
-    }
+      // -----------------------------------------------------------------------
+      // Next result received from the server.
+      // -----------------------------------------------------------------------
+      PGresult *pop() {
+        if (index_ == batch_.size()) {
+          batch_ = queue_.pop();
+          index_ = 0;
+        }
+        PGresult *pgresult = batch_[index_++];
+        done_ = isLast(pgresult);
+        return pgresult;
+      }
 
-    template<>
-    std::vector<array_item<timestamp_t>> Row::asArray<timestamp_t>(int column) const {
-      return readArray<timestamp_t>(result_, TIMESTAMPOID, column, timestamp_t { 0 });
-    }
+      bool done() const noexcept {
+        return done_;
+      }
 
-    template<>
-    std::vector<array_item<timetz_t>> Row::asArray<timetz_t>(int column) const {
-      return readArray<timetz_t>(result_, TIMETZOID, column, timetz_t { 0, 0 });
-    }
+    private:
+      PGconn   *pgconn_;
+      PGcancel *pgcancel_;  /**< Owned by the connection. **/
+      SpscQueue<std::vector<PGresult *>> queue_;
+      size_t    batchSize_;
+      std::thread thread_;
 
-    template<>
-    std::vector<array_item<time_t>> Row::asArray<time_t>(int column) const {
-      return readArray<time_t>(result_, TIMEOID, column, time_t { 0 });
-    }
+      std::vector<PGresult *> batch_;  /**< Batch being consumed. **/
+      size_t    index_;                /**< Next result in the batch. **/
+      bool      done_;                 /**< Last result has been consumed. **/
+      std::atomic<bool> received_;     /**< Last result has been received. **/
 
-    template<>
-    std::vector<array_item<interval_t>> Row::asArray<interval_t>(int column) const {
-      return readArray<interval_t>(result_, INTERVALOID, column, interval_t { 0, 0, 0 });
-    }
+      static bool isLast(PGresult *pgresult) {
+        return pgresult == nullptr || PQresultStatus(pgresult) != PGRES_SINGLE_TUPLE;
+      }
 
-    template<>
-    std::vector<array_item<std::string>> Row::asArray<std::string>(int column) const {
-      return readArray<std::string>(result_, UNKNOWNOID, column, std::string());
-    }
+      // -----------------------------------------------------------------------
+      // Background thread
+      // -----------------------------------------------------------------------
+      void run() {
+        bool last;
+        do {
+          std::vector<PGresult *> batch;
+          batch.reserve(batchSize_);
+          do {
+            PGresult *pgresult = PQgetResult(pgconn_);
+            batch.push_back(pgresult);
+            last = isLast(pgresult);
+            // The batch is sent as soon as the next row is not already
+            // available, so that the rows are not delayed by a slow network.
+          } while (!last && batch.size() < batchSize_ && !PQisBusy(pgconn_));
+          received_ = last;
+          queue_.push(std::move(batch));
+        } while (!last);
+      }
+    };
 
     // -------------------------------------------------------------------------
     // Result contructor
     // -------------------------------------------------------------------------
     Result::Result(Connection &conn)
-      : Row(*this), conn_(conn), begin_(*this), end_(*this) {
-      pgresult_ = nullptr;
+      : conn_(conn) {
       status_ = PGRES_EMPTY_QUERY;
     }
 
@@ -343,35 +269,51 @@ namespace db {
     // Destructor
     // -------------------------------------------------------------------------
     Result::~Result() {
+      stopPrefetch();
       if (pgresult_) {
         PQclear(pgresult_);
       }
     }
 
+    // -------------------------------------------------------------------------
+    // Prefetch the rows on a background thread
+    // -------------------------------------------------------------------------
+    Result &Result::prefetch(int batchSize, int batches) {
+      assert(batchSize > 0 && batches > 0);
+      if (status_ == PGRES_SINGLE_TUPLE && !prefetcher_) {
+        prefetcher_.reset(new Prefetcher(conn_, conn_.pgcancel_, batchSize, batches));
+      }
+      return *this;
+    }
+
+    void Result::stopPrefetch() noexcept {
+      prefetcher_.reset();
+    }
+
     // -------------------------------------------------------------------------
     // First row of the result
     // -------------------------------------------------------------------------
     Result::iterator Result::begin() {
-      return Result::iterator(&begin_);
+      // If there is no result available then begin() = end()
+      return Result::iterator(status_ == PGRES_SINGLE_TUPLE ? this : nullptr);
     }
 
     // -------------------------------------------------------------------------
     // Last row of the result
     // -------------------------------------------------------------------------
     Result::iterator Result::end() {
-      // If there is no result available then end() = begin()
-      return Result::iterator(status_ == PGRES_SINGLE_TUPLE ? &end_ : &begin_);
+      return Result::iterator(nullptr);
     }
 
     // -------------------------------------------------------------------------
     // Next row of the result
     // -------------------------------------------------------------------------
     Result::iterator Result::iterator::operator ++() {
-      ptr_->result_.next();
-      if (ptr_->result_.status_ != PGRES_SINGLE_TUPLE) {
+      ptr_->next();
+      if (ptr_->status_ != PGRES_SINGLE_TUPLE) {
         // We've reached the end
-        assert(ptr_->result_.status_ == PGRES_TUPLES_OK);
-        ptr_ = &ptr_->result_.end_;
+        assert(ptr_->status_ == PGRES_TUPLES_OK);
+        ptr_ = nullptr;
       }
       return iterator (ptr_);
     }
@@ -392,6 +334,7 @@ namespace db {
     void Result::first() {
       assert(pgresult_ == nullptr);
       num_ = 0;
+      descriptor_.reset();
       next();
     }
 
@@ -403,9 +346,23 @@ namespace db {
       if (pgresult_) {
         assert(status_ == PGRES_SINGLE_TUPLE);
         PQclear(pgresult_);
+        pgresult_ = nullptr;
+        status_ = PGRES_EMPTY_QUERY;
+      }
+
+      if (prefetcher_) {
+        pgresult_ = prefetcher_->pop();
+        if (pgresult_) {
+          conn_.received(pgresult_);
+        }
+        if (prefetcher_->done()) {
+          prefetcher_.reset();
+        }
+      }
+      else {
+        pgresult_ = conn_.getResult();
       }
 
-      pgresult_ = PQgetResult(conn_);
       assert(pgresult_);
       status_ = PQresultStatus(pgresult_);
       switch (status_) {
@@ -415,6 +372,7 @@ namespace db {
           break;
 
         case PGRES_TUPLES_OK:
+          descriptor_.reset();
           // The SELECT statement did not return any row or after the last row,
           // a zero-row object with status PGRES_TUPLES_OK is returned; this is
           // the signal that no more rows are expected.
@@ -436,6 +394,28 @@ namespace db {
 
     }
 
+    // -------------------------------------------------------------------------
+    // Discard the rows already received without waiting for the server.
+    // Returns true if the last row of the query has been received.
+    // -------------------------------------------------------------------------
+    bool Result::discardReceived() noexcept {
+      if (!PQconsumeInput(conn_)) {
+        return false;
+      }
+      while (!PQisBusy(conn_)) {
+        PGresult *pgresult = PQgetResult(conn_);
+        bool last = pgresult == nullptr || PQresultStatus(pgresult) != PGRES_SINGLE_TUPLE;
+        if (last && pgresult) {
+          conn_.received(pgresult);
+        }
+        PQclear(pgresult);
+        if (last) {
+          return true;
+        }
+      }
+      return false;
+    }
+
     // -------------------------------------------------------------------------
     // Clear the previous result of the connection
     // -------------------------------------------------------------------------
@@ -450,6 +430,7 @@ namespace db {
               status_ = PGRES_EMPTY_QUERY;
             }
             else {
+              conn_.received(pgresult_);
               status_ = PQresultStatus(pgresult_);
               switch (status_) {
                 case PGRES_COMMAND_OK:
@@ -485,18 +466,27 @@ namespace db {
           break;
 
         case PGRES_SINGLE_TUPLE:
-          next();
-          if (status_ == PGRES_SINGLE_TUPLE) {
-            // All results of the previous query have not been processed, we
-            // need to cancel it.
-            conn_.cancel();
+          // All the rows have not been fetched. The rows already sent by the
+          // server are discarded without being decoded and the query is
+          // cancelled if its last row has not been received yet. The
+          // connection is ready for the next command once the server has
+          // processed the cancel request.
+          PQclear(pgresult_);
+          pgresult_ = nullptr;
+          status_ = PGRES_EMPTY_QUERY;
+          if (prefetcher_) {
+            prefetcher_.reset(); // Cancel the query and stop the background thread.
           }
-          else if (status_ == PGRES_TUPLES_OK) {
-            PQclear(pgresult_);
-            pgresult_ = PQgetResult(conn_);
-            status_ = PGRES_EMPTY_QUERY;
+          else if (!discardReceived()) {
+            try {
+              conn_.cancel();
+            }
+            catch (ExecutionException &) {
+              // The cancel request could not be sent: the remaining rows are
+              // received and discarded.
+            }
           }
-          assert(pgresult_ == nullptr);
+          conn_.discard();
           break;
 
         case PGRES_EMPTY_QUERY:
@@ -508,5 +498,48 @@ namespace db {
 
     }
 
+    // -------------------------------------------------------------------------
+    // BufferedResult contructor
+    // -------------------------------------------------------------------------
+    BufferedResult::BufferedResult(PGresult *pgresult)
+      : pgresult_(pgresult) {
+      assert(pgresult_);
+    }
+
+    BufferedResult::BufferedResult(BufferedResult &&other) noexcept
+      : pgresult_(other.pgresult_) {
+      other.pgresult_ = nullptr;
+    }
+
+    // -------------------------------------------------------------------------
+    // Destructor
+    // -------------------------------------------------------------------------
+    BufferedResult::~BufferedResult() {
+      if (pgresult_) {
+        PQclear(pgresult_);
+      }
+    }
+
+    // -------------------------------------------------------------------------
+    // Number of rows and columns
+    // -------------------------------------------------------------------------
+    int BufferedResult::size() const noexcept {
+      return PQntuples(pgresult_);
+    }
+
+    int BufferedResult::columns() const noexcept {
+      return PQnfields(pgresult_);
+    }
+
+    // -------------------------------------------------------------------------
+    // Number of rows affected by the SQL command
+    // -------------------------------------------------------------------------
+    uint64_t BufferedResult::count() const noexcept {
+      assert(pgresult_);
+      const char *count = PQcmdTuples(pgresult_);
+      char *end;
+      return std::strtoull(count, &end, 10);
+    }
+
   } // namespace postgres
 }   // namespace db
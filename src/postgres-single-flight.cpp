@@ -0,0 +1,75 @@
+/**
+ * Copyright (c) 2016 Philippe FERDINAND
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ **/
+#include "postgres-single-flight.h"
+
+namespace db {
+  namespace postgres {
+
+    // -------------------------------------------------------------------------
+    // Number of queries in progress.
+    // -------------------------------------------------------------------------
+    size_t SingleFlight::size() const {
+      std::lock_guard<std::mutex> lock(mutex_);
+      return flights_.size();
+    }
+
+    // -------------------------------------------------------------------------
+    // Execute a query unless an identical one is in progress.
+    // -------------------------------------------------------------------------
+    SingleFlight::result_type SingleFlight::execute(const std::string &key,
+                                                    const std::function<result_type()> &query) {
+      std::promise<result_type> promise;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto it = flights_.find(key);
+        if (it != flights_.end()) {
+          std::shared_future<result_type> flight = it->second;
+          lock.unlock();
+          return flight.get();
+        }
+        flights_.emplace(key, promise.get_future().share());
+      }
+
+      // The flight is removed before the waiters are released so that a new
+      // query always gets fresh data.
+      result_type result;
+      try {
+        result = query();
+      }
+      catch (...) {
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          flights_.erase(key);
+        }
+        promise.set_exception(std::current_exception());
+        throw;
+      }
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        flights_.erase(key);
+      }
+      promise.set_value(result);
+      return result;
+    }
+
+  } // namespace postgres
+}   // namespace db
@@ -0,0 +1,65 @@
+/**
+ * Copyright (c) 2016 Philippe FERDINAND
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ **/
+#include "postgres-statements.h"
+
+namespace db {
+  namespace postgres {
+
+    // -------------------------------------------------------------------------
+    // Declare a statement.
+    // -------------------------------------------------------------------------
+    StatementRegistry &StatementRegistry::add(const std::string &name, const std::string &sql,
+                                              const std::vector<Oid> &types) {
+      std::shared_ptr<Statement> statement = std::make_shared<Statement>();
+      statement->name = name;
+      statement->sql = sql;
+      statement->types = types;
+
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto it = names_.find(name);
+      if (it != names_.end()) {
+        if (it->second->sql == sql && it->second->types == types) {
+          return *this;
+        }
+        throw ExecutionException("Statement " + name + " is already registered.");
+      }
+      names_[name] = statement;
+      statements_.push_back(statement);
+      return *this;
+    }
+
+    // -------------------------------------------------------------------------
+    // Find a statement.
+    // -------------------------------------------------------------------------
+    std::shared_ptr<const Statement> StatementRegistry::find(const std::string &name) const {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto it = names_.find(name);
+      return it == names_.end() ? nullptr : it->second;
+    }
+
+    std::vector<std::shared_ptr<const Statement>> StatementRegistry::statements() const {
+      std::lock_guard<std::mutex> lock(mutex_);
+      return statements_;
+    }
+
+  } // namespace postgres
+}   // namespace db
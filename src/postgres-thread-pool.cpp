@@ -0,0 +1,176 @@
+/**
+ * Copyright (c) 2016 Philippe FERDINAND
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ **/
+#include "postgres-thread-pool.h"
+
+namespace db {
+  namespace postgres {
+
+    // -------------------------------------------------------------------------
+    // Constructor
+    // -------------------------------------------------------------------------
+    ThreadPool::ThreadPool(unsigned threads) {
+      task_ = nullptr;
+      busy_ = 0;
+      generation_ = 0;
+      stop_ = false;
+
+      // The last queue is the one of the thread calling run().
+      for (unsigned i = 0; i <= threads; i++) {
+        queues_.push_back(std::unique_ptr<Queue>(new Queue()));
+      }
+
+      threads_.reserve(threads);
+      for (unsigned i = 0; i < threads; i++) {
+        threads_.push_back(std::thread(&ThreadPool::loop, this, i));
+      }
+    }
+
+    // -------------------------------------------------------------------------
+    // Destructor
+    // -------------------------------------------------------------------------
+    ThreadPool::~ThreadPool() {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+      }
+      wakeup_.notify_all();
+      for (auto &thread: threads_) {
+        thread.join();
+      }
+    }
+
+    // -------------------------------------------------------------------------
+    // Run a job and wait for all its tasks to complete.
+    // -------------------------------------------------------------------------
+    void ThreadPool::run(size_t count, const std::function<void(size_t)> &task) {
+      if (count == 0) {
+        return;
+      }
+
+      std::lock_guard<std::mutex> running(run_);
+
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t i = 0; i < count; i++) {
+          Queue &queue = *queues_[i % queues_.size()];
+          std::lock_guard<std::mutex> queueLock(queue.mutex);
+          queue.tasks.push_back(i);
+        }
+        task_ = &task;
+        error_ = nullptr;
+        busy_ = threads_.size();
+        generation_++;
+      }
+      wakeup_.notify_all();
+
+      work(queues_.size() - 1);
+
+      std::exception_ptr error;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [this] { return busy_ == 0; });
+        task_ = nullptr;
+        std::swap(error, error_);
+      }
+
+      if (error) {
+        std::rethrow_exception(error);
+      }
+    }
+
+    // -------------------------------------------------------------------------
+    // Main loop of a worker thread.
+    // -------------------------------------------------------------------------
+    void ThreadPool::loop(size_t index) {
+      size_t generation = 0;
+      while (true) {
+        {
+          std::unique_lock<std::mutex> lock(mutex_);
+          wakeup_.wait(lock, [&] { return stop_ || generation_ != generation; });
+          if (stop_) {
+            return;
+          }
+          generation = generation_;
+        }
+
+        work(index);
+
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          if (--busy_ == 0) {
+            done_.notify_one();
+          }
+        }
+      }
+    }
+
+    // -------------------------------------------------------------------------
+    // Execute tasks until all the queues are empty.
+    // -------------------------------------------------------------------------
+    void ThreadPool::work(size_t index) {
+      // All the tasks are queued before the job starts, so once every queue
+      // is empty there is nothing left to steal.
+      size_t task;
+      while (next(index, &task)) {
+        try {
+          (*task_)(task);
+        }
+        catch (...) {
+          std::lock_guard<std::mutex> lock(mutex_);
+          if (!error_) {
+            error_ = std::current_exception();
+          }
+        }
+      }
+    }
+
+    // -------------------------------------------------------------------------
+    // Take a task from its own queue or steal one from another queue.
+    // -------------------------------------------------------------------------
+    bool ThreadPool::next(size_t index, size_t *task) {
+      {
+        // Own tasks are taken from the back...
+        Queue &queue = *queues_[index];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty()) {
+          *task = queue.tasks.back();
+          queue.tasks.pop_back();
+          return true;
+        }
+      }
+
+      for (size_t i = 1; i < queues_.size(); i++) {
+        // ...while stolen tasks are taken from the front.
+        Queue &queue = *queues_[(index + i) % queues_.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty()) {
+          *task = queue.tasks.front();
+          queue.tasks.pop_front();
+          return true;
+        }
+      }
+
+      return false;
+    }
+
+  } // namespace postgres
+}   // namespace db
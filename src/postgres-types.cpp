@@ -21,7 +21,18 @@
  **/
 #include "postgres-types.h"
 
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
 #include <cstring>
+#include <cerrno>
+#include <cmath>
+#include <limits>
+#include <locale.h>
+#include <stdlib.h>
+#ifdef __APPLE__
+#include <xlocale.h>
+#endif
 
 
 // -------------------------------------------------------------------------
@@ -251,7 +262,7 @@ namespace db {
 
     template <>
     char *write(date_t d, char *buf) {
-      int32_t v = ((d.epoch_date - (d.epoch_date % 86400)) / 86400) - DAYS_UNIX_TO_J2000_EPOCH;
+      int32_t v = d.epoch_date / 86400 - DAYS_UNIX_TO_J2000_EPOCH;
       return write(v, buf);
     }
 
@@ -352,5 +363,537 @@ namespace db {
       return buf + sizeof(interval_t);
     }
 
+    // -------------------------------------------------------------------------
+    // First element of an array.
+    //
+    // The data should look like this:
+    //
+    // struct pg_array {
+    //   int32_t ndim; /* Number of dimensions */
+    //   int32_t ign;  /* offset for data, removed by libpq */
+    //   Oid elemtype; /* type of element in the array */
+    //
+    //   /* First dimension */
+    //   int32_t size;  /* Number of elements */
+    //   int32_t index; /* Index of first element */
+    //   T first_value; /* Beginning of the data */
+    // }
+    // -------------------------------------------------------------------------
+    const char *internal::array_elements(const char *value, int32_t &size, Oid &elemType) {
+      size = 0;
+      elemType = InvalidOid;
+      if (value == nullptr) {
+        return nullptr;
+      }
+
+      char *buf = const_cast<char *>(value);
+      int32_t ndim = read<int32_t>(&buf);
+      read<int32_t>(&buf); // skip
+      elemType = Oid(read<int32_t>(&buf));
+      if (ndim == 0) {
+        return buf; // empty array
+      }
+      assert(ndim == 1); // only array of 1 dimmension are supported so far.
+
+      // First dimension
+      size = read<int32_t>(&buf);
+      read<int32_t>(&buf); // skip the index of first element.
+      return buf;
+    }
+
+    // -------------------------------------------------------------------------
+    // Values in text format.
+    //
+    // Dates and timestamps have a fixed layout with the ISO DateStyle:
+    // `YYYY-MM-DD[ HH:MM:SS[.ffffff][+HH[:MM[:SS]]]][ BC]`, years having 4 digits
+    // or more.
+    // -------------------------------------------------------------------------
+    static bool parseDigits(const char *&p, const char *end, int count, int64_t &value) {
+      value = 0;
+      for (int i = 0; i < count; i++, p++) {
+        if (p == end || *p < '0' || *p > '9') {
+          return false;
+        }
+        value = value * 10 + (*p - '0');
+      }
+      return true;
+    }
+
+    // Days since 1970-01-01 in the proleptic Gregorian calendar.
+    static int64_t daysFromCivil(int64_t y, int64_t m, int64_t d) {
+      y -= m <= 2;
+      int64_t era = (y >= 0 ? y : y - 399) / 400;
+      int64_t yoe = y - era * 400;
+      int64_t doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+      int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+      return era * 146097 + doe - 719468;
+    }
+
+    // Microseconds since Unix epoch time, in UTC when `zone` is true.
+    static int64_t parseTimestamp(const char *buf, int32_t length, bool time, bool zone) {
+      const char *p = buf;
+      const char *end = buf + length;
+      if (length == 8 && std::memcmp(buf, "infinity", 8) == 0) {
+        return std::numeric_limits<int64_t>::max();
+      }
+      if (length == 9 && std::memcmp(buf, "-infinity", 9) == 0) {
+        return std::numeric_limits<int64_t>::min();
+      }
+
+      bool bc = length > 3 && std::memcmp(end - 3, " BC", 3) == 0;
+      if (bc) {
+        end -= 3;
+      }
+
+      int64_t year = 0, month, day, hour = 0, minute = 0, second = 0, micros = 0, offset = 0;
+      const char *digits = p;
+      while (p < end && *p >= '0' && *p <= '9') {
+        year = year * 10 + (*p++ - '0');
+      }
+      bool valid = p - digits >= 4
+                && p < end && *p++ == '-' && parseDigits(p, end, 2, month)
+                && p < end && *p++ == '-' && parseDigits(p, end, 2, day);
+
+      if (valid && time) {
+        valid = p < end && *p++ == ' ' && parseDigits(p, end, 2, hour)
+             && p < end && *p++ == ':' && parseDigits(p, end, 2, minute)
+             && p < end && *p++ == ':' && parseDigits(p, end, 2, second);
+        if (valid && p < end && *p == '.') {
+          int64_t scale = 100000;
+          for (p++; p < end && *p >= '0' && *p <= '9'; p++, scale /= 10) {
+            micros += (*p - '0') * scale;
+          }
+        }
+        if (valid && zone) {
+          int64_t sign = p < end && *p == '-' ? -1 : 1;
+          int64_t hours = 0, minutes = 0, seconds = 0;
+          valid = p < end && (*p == '+' || *p == '-') && parseDigits(++p, end, 2, hours);
+          if (valid && p < end && *p == ':') {
+            valid = parseDigits(++p, end, 2, minutes);
+          }
+          if (valid && p < end && *p == ':') {
+            valid = parseDigits(++p, end, 2, seconds);
+          }
+          offset = sign * (hours * 3600 + minutes * 60 + seconds);
+        }
+      }
+
+      if (!valid || p != end) {
+        throw ExecutionException("Unexpected date format \"" + std::string(buf, size_t(length)) +
+                                 "\", only the ISO DateStyle is supported in text format.");
+      }
+
+      if (bc) {
+        year = 1 - year;
+      }
+      int64_t seconds = daysFromCivil(year, month, day) * 86400
+                      + hour * 3600 + minute * 60 + second - offset;
+      return seconds * 1000000 + micros;
+    }
+
+    // Independent of the locale of the process: PostgreSQL always uses a dot.
+#ifdef _WIN32
+    static _locale_t numericLocale() {
+      static _locale_t locale = _create_locale(LC_NUMERIC, "C");
+      return locale;
+    }
+
+    static float strtoC(const char *s, char **end, float) {
+      return _strtof_l(s, end, numericLocale());
+    }
+
+    static double strtoC(const char *s, char **end, double) {
+      return _strtod_l(s, end, numericLocale());
+    }
+#else
+    static locale_t numericLocale() {
+      static locale_t locale = newlocale(LC_NUMERIC_MASK, "C", locale_t(0));
+      return locale;
+    }
+
+    static float strtoC(const char *s, char **end, float) {
+      return strtof_l(s, end, numericLocale());
+    }
+
+    static double strtoC(const char *s, char **end, double) {
+      return strtod_l(s, end, numericLocale());
+    }
+#endif
+
+    // NaN, Infinity and -Infinity are also accepted by strtod(). An underflow
+    // yields a subnormal value or zero and is not an error.
+    template<typename T>
+    static T parseFloat(const char *buf, int32_t length) {
+      char text[64];
+      bool valid = length > 0 && size_t(length) < sizeof(text)
+                && ((*buf >= '0' && *buf <= '9') || *buf == '-' || *buf == '.'
+                    || *buf == 'N' || *buf == 'I');
+      T value = 0;
+      if (valid) {
+        std::memcpy(text, buf, size_t(length));
+        text[length] = '\0';
+        char *end;
+        errno = 0;
+        value = strtoC(text, &end, T());
+        valid = end == text + length
+             && !(errno == ERANGE && std::fabs(value) == std::numeric_limits<T>::infinity());
+      }
+      if (!valid) {
+        throw ExecutionException("Invalid value \"" + std::string(buf, size_t(length)) +
+                                 "\" for the C++ floating point type.");
+      }
+      return value;
+    }
+
+    float internal::text_reader<float>::read(const char *buf, int32_t length) {
+      return parseFloat<float>(buf, length);
+    }
+
+    double internal::text_reader<double>::read(const char *buf, int32_t length) {
+      return parseFloat<double>(buf, length);
+    }
+
+    date_t internal::text_reader<date_t>::read(const char *buf, int32_t length) {
+      if (length == 8 && std::memcmp(buf, "infinity", 8) == 0) {
+        return date_t { std::numeric_limits<int32_t>::max() };
+      }
+      if (length == 9 && std::memcmp(buf, "-infinity", 9) == 0) {
+        return date_t { std::numeric_limits<int32_t>::min() };
+      }
+      return date_t { int32_t(parseTimestamp(buf, length, false, false) / 1000000) };
+    }
+
+    timestamp_t internal::text_reader<timestamp_t>::read(const char *buf, int32_t length) {
+      return timestamp_t { parseTimestamp(buf, length, true, false) };
+    }
+
+    timestamptz_t internal::text_reader<timestamptz_t>::read(const char *buf, int32_t length) {
+      return timestamptz_t { parseTimestamp(buf, length, true, true) };
+    }
+
+    std::vector<uint8_t> internal::text_reader<std::vector<uint8_t>>::read(const char *buf, int32_t length) {
+      if (length < 2 || buf[0] != '\\' || buf[1] != 'x' || length % 2 != 0) {
+        throw ExecutionException("Unexpected bytea format, only the hex bytea_output is supported in text format.");
+      }
+      std::vector<uint8_t> bytes(size_t(length - 2) / 2);
+      for (size_t i = 0; i < bytes.size(); i++) {
+        uint8_t byte = 0;
+        for (int j = 0; j < 2; j++) {
+          char c = buf[2 + i * 2 + j];
+          int nibble = c >= '0' && c <= '9' ? c - '0'
+                     : (c | 0x20) >= 'a' && (c | 0x20) <= 'f' ? (c | 0x20) - 'a' + 10
+                     : -1;
+          if (nibble < 0) {
+            throw ExecutionException("Invalid hex digit in bytea value \"" +
+                                     std::string(buf, size_t(length)) + "\".");
+          }
+          byte = uint8_t(byte << 4 | nibble);
+        }
+        bytes[i] = byte;
+      }
+      return bytes;
+    }
+
+    // -------------------------------------------------------------------------
+    // text_array
+    // -------------------------------------------------------------------------
+
+    void text_array::clear() {
+      chars_.clear();
+      offsets_.resize(1);
+      nulls_.clear();
+    }
+
+    void text_array::push_back(const char *value, size_t length) {
+      if (value) {
+        chars_.insert(chars_.end(), value, value + length);
+      }
+      chars_.push_back('\0');
+      offsets_.push_back(uint32_t(chars_.size()));
+      nulls_.push_back(value == nullptr);
+    }
+
+    void text_array::read(const char *buf, int32_t length) {
+      clear();
+      char *p = const_cast<char *>(buf);
+      int32_t ndim = postgres::read<int32_t>(&p);
+      postgres::read<int32_t>(&p); // skip
+      postgres::read<int32_t>(&p); // element type
+      if (ndim == 0) {
+        return; // empty array
+      }
+      assert(ndim == 1); // only array of 1 dimmension are supported so far.
+
+      int32_t size = postgres::read<int32_t>(&p);
+      postgres::read<int32_t>(&p); // skip the index of first element.
+
+      // The characters and their null terminators fit in the binary value.
+      chars_.reserve(size_t(length));
+      offsets_.reserve(size_t(size) + 1);
+      nulls_.reserve(size_t(size));
+      for (int32_t i = 0; i < size; i++) {
+        int32_t elemSize = postgres::read<int32_t>(&p);
+        if (elemSize == -1) {
+          push_back(nullptr, 0);
+        }
+        else {
+          push_back(p, size_t(elemSize));
+          p += elemSize;
+        }
+      }
+    }
+
+    int32_t type_traits<text_array>::length(const text_array &value) {
+      int32_t length = 5 * sizeof(int32_t); // array headers
+      for (size_t i = 0; i < value.size(); i++) {
+        length += int32_t(sizeof(int32_t) + value.length(i));
+      }
+      return length;
+    }
+
+    char *type_traits<text_array>::write(const text_array &value, char *buf) {
+      buf = postgres::write(int32_t(1), buf);          /* Number of dimensions */
+      buf = postgres::write(int32_t(0), buf);          /* ignored */
+      buf = postgres::write(int32_t(VARCHAROID), buf); /* type of elements in the array */
+      buf = postgres::write(int32_t(value.size()), buf);
+      buf = postgres::write(int32_t(1), buf);          /* Index of first element */
+      for (size_t i = 0; i < value.size(); i++) {
+        if (value.isNull(i)) {
+          buf = postgres::write(int32_t(-1), buf);
+        }
+        else {
+          buf = postgres::write(int32_t(value.length(i)), buf);
+          std::memcpy(buf, value[i], value.length(i));
+          buf += value.length(i);
+        }
+      }
+      return buf;
+    }
+
+    // -------------------------------------------------------------------------
+    // inet and cidr
+    // -------------------------------------------------------------------------
+
+    // Compare the first `bits` bits of two addresses.
+    static int compareBits(const uint8_t *a, const uint8_t *b, int bits) {
+      int order = std::memcmp(a, b, size_t(bits / 8));
+      if (order != 0 || bits % 8 == 0) {
+        return order;
+      }
+      int mask = 0xFF << (8 - bits % 8);
+      return (a[bits / 8] & mask) - (b[bits / 8] & mask);
+    }
+
+    int compare(const inet_t &a, const inet_t &b) {
+      if (a.family != b.family) {
+        return a.family < b.family ? -1 : 1;
+      }
+      int order = compareBits(a.address, b.address, std::min(a.bits, b.bits));
+      if (order == 0) {
+        order = int(a.bits) - int(b.bits);
+      }
+      if (order == 0) {
+        order = compareBits(a.address, b.address, a.size() * 8);
+      }
+      return order;
+    }
+
+    // Format an address like inet_net_ntop() in PostgreSQL.
+    static std::string format(const inet_t &inet, bool cidr) {
+      char buf[64];
+      int n = 0;
+      if (inet.family == 6) {
+        uint16_t words[8];
+        for (int i = 0; i < 8; i++) {
+          words[i] = uint16_t((inet.address[2 * i] << 8) | inet.address[2 * i + 1]);
+        }
+
+        // Longest run of at least two zero words, replaced by "::"
+        int best = -1, bestLength = 0;
+        for (int i = 0; i < 8; i++) {
+          int length = 0;
+          while (i + length < 8 && words[i + length] == 0) {
+            length++;
+          }
+          if (length >= 2 && length > bestLength) {
+            best = i;
+            bestLength = length;
+          }
+          i += length;
+        }
+
+        for (int i = 0; i < 8; i++) {
+          if (i == best) {
+            n += std::snprintf(buf + n, sizeof(buf) - n, ":");
+            i += bestLength - 1;
+            if (i == 7) {
+              n += std::snprintf(buf + n, sizeof(buf) - n, ":");
+            }
+            continue;
+          }
+          if (i > 0) {
+            n += std::snprintf(buf + n, sizeof(buf) - n, ":");
+          }
+          // IPv4 compatible or mapped address
+          if (i == 6 && best == 0 && (bestLength == 6 || (bestLength == 5 && words[5] == 0xFFFF))) {
+            n += std::snprintf(buf + n, sizeof(buf) - n, "%u.%u.%u.%u", inet.address[12],
+                               inet.address[13], inet.address[14], inet.address[15]);
+            break;
+          }
+          n += std::snprintf(buf + n, sizeof(buf) - n, "%x", words[i]);
+        }
+      }
+      else {
+        n = std::snprintf(buf, sizeof(buf), "%u.%u.%u.%u", inet.address[0],
+                          inet.address[1], inet.address[2], inet.address[3]);
+      }
+      if (cidr || inet.bits != inet.size() * 8) {
+        std::snprintf(buf + n, sizeof(buf) - n, "/%u", inet.bits);
+      }
+      return std::string(buf);
+    }
+
+    std::string inet_t::str() const {
+      return format(*this, false);
+    }
+
+    std::string cidr_t::str() const {
+      return format(*this, true);
+    }
+
+    // -------------------------------------------------------------------------
+    // macaddr
+    // -------------------------------------------------------------------------
+
+    std::string macaddr_t::str() const {
+      char buf[18];
+      std::snprintf(buf, sizeof(buf), "%02x:%02x:%02x:%02x:%02x:%02x",
+                    address[0], address[1], address[2], address[3], address[4], address[5]);
+      return std::string(buf);
+    }
+
+    // -------------------------------------------------------------------------
+    // hstore
+    //
+    // struct pg_hstore {
+    //   int32_t count;         /* Number of pairs */
+    //
+    //   /* For each pair */
+    //   int32_t keyLength;
+    //   char    key[keyLength];
+    //   int32_t valueLength;   /* -1 if null */
+    //   char    value[valueLength];
+    // }
+    // -------------------------------------------------------------------------
+
+    hstore_view::iterator::iterator(const char *pos, int32_t count)
+    : pos_(pos), count_(count) {
+      decode();
+    }
+
+    hstore_view::iterator hstore_view::iterator::operator ++() {
+      count_--;
+      decode();
+      return *this;
+    }
+
+    void hstore_view::iterator::decode() {
+      if (count_ > 0) {
+        entry_.keyLength = read_value<int32_t>(pos_, sizeof(int32_t));
+        entry_.key = pos_ + sizeof(int32_t);
+        pos_ = entry_.key + entry_.keyLength;
+        entry_.valueLength = read_value<int32_t>(pos_, sizeof(int32_t));
+        entry_.value = pos_ + sizeof(int32_t);
+        pos_ = entry_.value + std::max(entry_.valueLength, 0);
+      }
+    }
+
+    int32_t hstore_view::size() const {
+      return data_ ? read_value<int32_t>(data_, sizeof(int32_t)) : 0;
+    }
+
+    hstore_view::iterator hstore_view::begin() const {
+      return data_ ? iterator(data_ + sizeof(int32_t), size()) : end();
+    }
+
+    hstore_view::iterator hstore_view::end() const {
+      return iterator(nullptr, 0);
+    }
+
+    hstore_view::iterator hstore_view::find(const char *key, size_t length) const {
+      // Pairs are sorted by length of the key then by content.
+      iterator i = begin(), last = end();
+      for (; i != last; ++i) {
+        if (size_t(i->keyLength) > length) {
+          break;
+        }
+        if (size_t(i->keyLength) == length) {
+          int order = std::memcmp(i->key, key, length);
+          if (order == 0) {
+            return i;
+          }
+          if (order > 0) {
+            break;
+          }
+        }
+      }
+      return last;
+    }
+
+    // -------------------------------------------------------------------------
+    // tsvector
+    //
+    // struct pg_tsvector {
+    //   int32_t  count;        /* Number of lexemes */
+    //
+    //   /* For each lexeme */
+    //   char     lexeme[];     /* Null terminated */
+    //   uint16_t npos;         /* Number of positions */
+    //   uint16_t pos[npos];    /* Weight (2 bits) and position (14 bits) */
+    // }
+    // -------------------------------------------------------------------------
+
+    int tsvector_view::entry::position(int i) const {
+      return uint16_t(read_value<int16_t>(data + i * sizeof(int16_t), sizeof(int16_t))) & 0x3FFF;
+    }
+
+    char tsvector_view::entry::weight(int i) const {
+      return char('D' - (uint16_t(read_value<int16_t>(data + i * sizeof(int16_t), sizeof(int16_t))) >> 14));
+    }
+
+    tsvector_view::iterator::iterator(const char *pos, int32_t count)
+    : pos_(pos), count_(count) {
+      decode();
+    }
+
+    tsvector_view::iterator tsvector_view::iterator::operator ++() {
+      count_--;
+      decode();
+      return *this;
+    }
+
+    void tsvector_view::iterator::decode() {
+      if (count_ > 0) {
+        entry_.lexeme = pos_;
+        entry_.length = int32_t(std::strlen(pos_));
+        pos_ += entry_.length + 1;
+        entry_.positions = uint16_t(read_value<int16_t>(pos_, sizeof(int16_t)));
+        entry_.data = pos_ + sizeof(int16_t);
+        pos_ = entry_.data + entry_.positions * sizeof(int16_t);
+      }
+    }
+
+    int32_t tsvector_view::size() const {
+      return data_ ? read_value<int32_t>(data_, sizeof(int32_t)) : 0;
+    }
+
+    tsvector_view::iterator tsvector_view::begin() const {
+      return data_ ? iterator(data_ + sizeof(int32_t), size()) : end();
+    }
+
+    tsvector_view::iterator tsvector_view::end() const {
+      return iterator(nullptr, 0);
+    }
+
   } // namespace postgres
 }   // namespace db
@@ -0,0 +1,88 @@
+/**
+ * Copyright (c) 2016 Philippe FERDINAND
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ **/
+#include "gtest/gtest.h"
+#include "postgres-batch-loader.h"
+#include "postgres-exceptions.h"
+
+#include <thread>
+
+using namespace db::postgres;
+
+TEST(batch_loader, load) {
+
+  Connection cnx;
+  cnx.connect();
+
+  std::vector<std::shared_future<BatchLoader<int32_t>::rows_type>> futures;
+  {
+    BatchLoader<int32_t> loader(cnx,
+      "SELECT n, 'name ' || n FROM generate_series(1, 100) n, generate_series(1, 2) m WHERE n = ANY($1)",
+      0, 8, std::chrono::milliseconds(20));
+
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    for (int i = 0; i < 16; i++) {
+      threads.push_back(std::thread([&, i] {
+        auto future = loader.load(i % 10 + 95);
+        std::lock_guard<std::mutex> lock(mutex);
+        futures.push_back(future);
+      }));
+    }
+    for (auto &thread: threads) {
+      thread.join();
+    }
+
+    auto future = loader.load(42);
+    auto &rows = future.get();
+    ASSERT_EQ(2, rows.size());
+    EXPECT_EQ(42, rows[0].as<int32_t>(0));
+    EXPECT_EQ("name 42", rows[1].as<std::string>(1));
+  }
+
+  ASSERT_EQ(16, futures.size());
+  for (auto &future: futures) {
+    auto &rows = future.get();
+    int32_t key = rows.empty() ? 0 : rows[0].as<int32_t>(0);
+    if (key == 0) {
+      continue;  // keys above 100 have no row
+    }
+    ASSERT_EQ(2, rows.size());
+    EXPECT_EQ("name " + std::to_string(key), rows[0].as<std::string>(1));
+  }
+
+  // The connection is usable once the loader is destroyed.
+  EXPECT_EQ(1, cnx.execute("SELECT 1").as<int32_t>(0));
+
+}
+
+TEST(batch_loader, error) {
+
+  Connection cnx;
+  cnx.connect();
+
+  BatchLoader<int32_t> loader(cnx, "SELECT n FROM missing_table WHERE n = ANY($1)");
+  auto first = loader.load(1);
+  auto second = loader.load(2);
+  EXPECT_THROW(first.get(), ExecutionException);
+  EXPECT_THROW(second.get(), ExecutionException);
+
+}
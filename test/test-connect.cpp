@@ -32,3 +32,48 @@ TEST(connect, sync) {
   EXPECT_THROW(cnx.connect("postgresql://invalid_user@localhost"), ConnectionException);
 
 }
+
+TEST(connect, parameters) {
+
+  Connection cnx;
+  cnx.connect();
+
+  cnx.set({ { "search_path", "pg_catalog" }, { "statement_timeout", "5s" }, { "work_mem", "64MB" } });
+  EXPECT_EQ("64MB", cnx.execute("SHOW work_mem").as<std::string>(0));
+  EXPECT_EQ("5s", cnx.parameter("statement_timeout"));
+  EXPECT_EQ("64MB", cnx.parameter("Work_Mem"));
+
+  // Parameters already set are skipped, even after other queries: the change
+  // made by set_config() is not tracked.
+  cnx.execute("SELECT 1");
+  cnx.execute("SELECT set_config('work_mem', '1MB', false)");
+  cnx.set("work_mem", "64MB");
+  EXPECT_EQ("1MB", cnx.execute("SHOW work_mem").as<std::string>(0));
+
+  // Parameters changed by SET, RESET or DISCARD are set again.
+  cnx.execute("SET work_mem TO '1MB'");
+  cnx.set("work_mem", "64MB");
+  EXPECT_EQ("64MB", cnx.execute("SHOW work_mem").as<std::string>(0));
+  cnx.execute("RESET ALL");
+  cnx.set("work_mem", "64MB");
+  EXPECT_EQ("64MB", cnx.execute("SHOW work_mem").as<std::string>(0));
+
+  // Parameters reported by the server are up to date, whatever the case of
+  // their name.
+  cnx.execute("SET application_name TO 'libpqmxx'");
+  EXPECT_EQ("libpqmxx", cnx.parameter("application_name"));
+  cnx.execute("SET DateStyle TO 'ISO, DMY'");
+  EXPECT_EQ("ISO, DMY", cnx.parameter("datestyle"));
+  cnx.set("datestyle", "ISO, MDY");
+  EXPECT_EQ("ISO, MDY", cnx.execute("SHOW DateStyle").as<std::string>(0));
+
+  // Parameters set in a transaction rolled back are forgotten.
+  cnx.begin();
+  cnx.set("work_mem", "2MB");
+  cnx.rollback();
+  cnx.set("work_mem", "2MB");
+  EXPECT_EQ("2MB", cnx.execute("SHOW work_mem").as<std::string>(0));
+
+  EXPECT_THROW(cnx.set("work_mem", "invalid"), ExecutionException);
+
+}
@@ -94,3 +94,73 @@ TEST(iterator, sync_rownum) {
   EXPECT_EQ(actual, 12);
 
 }
+
+TEST(iterator, prefetch) {
+
+  Connection cnx;
+  cnx.connect();
+
+  int64_t actual = 0;
+  int32_t rows = 0;
+
+  auto &result = cnx.execute("SELECT generate_series(1, 10000)").prefetch(100, 2);
+  for (auto &row: result) {
+    actual += row.as<int32_t>(0);
+    rows++;
+    EXPECT_EQ(rows, row.num());
+  }
+
+  EXPECT_EQ(10000, rows);
+  EXPECT_EQ(50005000, actual);
+
+  // The connection is available for the next query.
+  EXPECT_EQ(42, cnx.execute("SELECT 42").as<int32_t>(0));
+
+}
+
+TEST(iterator, prefetch_partial) {
+
+  Connection cnx;
+  cnx.connect();
+
+  int32_t rows = 0;
+  for (auto &row: cnx.execute("SELECT generate_series(1, 100000)").prefetch()) {
+    if (row.as<int32_t>(0) == 10) {
+      break;
+    }
+    rows++;
+  }
+
+  EXPECT_EQ(9, rows);
+  EXPECT_EQ(42, cnx.execute("SELECT 42").as<int32_t>(0));
+
+}
+
+TEST(iterator, stream) {
+
+  Connection cnx;
+  cnx.connect();
+
+  int64_t sum = 0;
+  std::string names;
+
+  uint64_t rows = cnx.stream("SELECT i, 'n' || i FROM generate_series(1, $1) AS i", 3,
+    [&](int32_t i, const char *name) {
+      sum += i;
+      names += name;
+    });
+
+  EXPECT_EQ(3, rows);
+  EXPECT_EQ(6, sum);
+  EXPECT_STREQ("n1n2n3", names.c_str());
+
+#ifdef LIBPQMXX_STRING_VIEW
+  cnx.stream("SELECT 'hello'::text", [](std::string_view hello) {
+    EXPECT_EQ("hello", hello);
+  });
+#endif
+
+  EXPECT_EQ(0, cnx.stream("SELECT 1 WHERE 1=2", [](int32_t) {}));
+  EXPECT_THROW(cnx.stream("SELECT 1", [](int32_t, int32_t) {}), ExecutionException);
+
+}
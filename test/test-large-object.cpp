@@ -0,0 +1,68 @@
+/**
+ * Copyright (c) 2016 Philippe FERDINAND
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ **/
+#include "gtest/gtest.h"
+#include "postgres-large-object.h"
+#include "postgres-exceptions.h"
+
+using namespace db::postgres;
+
+TEST(large_object, read_write) {
+
+  Connection cnx;
+  cnx.connect();
+  cnx.begin();
+
+  Oid oid = LargeObject::create(cnx);
+  std::vector<char> data(100000);
+  for (size_t i = 0; i < data.size(); i++) {
+    data[i] = char(i % 251);
+  }
+
+  {
+    LargeObject blob(cnx, oid, LargeObject::READ_WRITE, 4096);
+    blob.write(data.data(), 10);                   // buffered
+    blob.write(data.data() + 10, data.size() - 10); // larger than the buffer
+    EXPECT_EQ(int64_t(data.size()), blob.tell());
+
+    std::vector<char> read(data.size() + 10);
+    EXPECT_EQ(0, blob.seek(0));
+    EXPECT_EQ(100, blob.read(read.data(), 100));
+    EXPECT_EQ(100, blob.tell());
+    EXPECT_EQ(data.size() - 100, blob.read(read.data() + 100, read.size() - 100));
+    read.resize(data.size());
+    EXPECT_EQ(data, read);
+
+    blob.seek(-10, SEEK_END);
+    blob.write("0123456789", 10);
+    blob.truncate(5);
+    blob.seek(0);
+    char head[10];
+    EXPECT_EQ(5, blob.read(head, sizeof(head)));
+    EXPECT_EQ(0, std::memcmp(head, data.data(), 5));
+    blob.close();
+  }
+
+  LargeObject::unlink(cnx, oid);
+  EXPECT_THROW(LargeObject(cnx, oid), ExecutionException);
+  cnx.rollback();
+
+}
@@ -0,0 +1,108 @@
+/**
+ * Copyright (c) 2016 Philippe FERDINAND
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ **/
+#include "gtest/gtest.h"
+#include "postgres-connection.h"
+#include "postgres-exceptions.h"
+
+#include <atomic>
+
+using namespace db::postgres;
+
+TEST(thread_pool, run) {
+
+  ThreadPool pool(4);
+  std::vector<std::atomic<int>> counters(1000);
+  for (int n = 0; n < 3; n++) {
+    pool.run(counters.size(), [&](size_t task) {
+      counters[task]++;
+    });
+  }
+
+  for (auto &counter: counters) {
+    EXPECT_EQ(3, counter);
+  }
+
+}
+
+TEST(thread_pool, exception) {
+
+  ThreadPool pool(2);
+  std::atomic<int> executed(0);
+  EXPECT_THROW(pool.run(10, [&](size_t task) {
+    executed++;
+    if (task == 5) {
+      throw std::runtime_error("task failed");
+    }
+  }), std::runtime_error);
+  EXPECT_EQ(10, executed);
+
+}
+
+TEST(buffered_result, decode) {
+
+  Connection cnx;
+  cnx.connect();
+
+  ThreadPool pool(4);
+  auto result = cnx.executeBuffered(R"SQL(
+
+    SELECT i, CASE WHEN i % 10 = 0 THEN NULL ELSE i * 2::bigint END, 'row ' || i
+      FROM generate_series(1, $1) AS i
+
+  )SQL", 10000);
+
+  ASSERT_EQ(10000, result.size());
+  ASSERT_EQ(3, result.columns());
+
+  std::vector<int32_t> ids(result.size());
+  std::vector<array_item<int64_t>> doubles(result.size());
+  result.decode(pool, ids.data(), doubles.data());
+
+  for (int i = 0; i < result.size(); i++) {
+    EXPECT_EQ(i + 1, ids[i]);
+    if ((i + 1) % 10 == 0) {
+      EXPECT_TRUE(doubles[i].isNull);
+    }
+    else {
+      EXPECT_EQ((i + 1) * 2, doubles[i].value);
+    }
+  }
+
+  std::vector<std::string> labels(result.size());
+  result.decode(pool, nullptr, nullptr, labels.data());
+  EXPECT_STREQ("row 42", labels[41].c_str());
+
+  std::vector<std::string> typed(result.size());
+  result.decode(pool, static_cast<int32_t *>(nullptr), nullptr, typed.data());
+  EXPECT_STREQ("row 42", typed[41].c_str());
+
+}
+
+TEST(buffered_result, error) {
+
+  Connection cnx;
+  cnx.connect();
+
+  EXPECT_THROW(cnx.executeBuffered("SELECT * FROM unknown_table"), ExecutionException);
+  EXPECT_EQ(42, cnx.execute("SELECT 42").as<int32_t>(0));
+
+}
@@ -25,6 +25,20 @@
 
 using namespace db::postgres;
 
+enum class mood { sad, ok, happy };
+
+namespace db {
+  namespace postgres {
+    template<>
+    struct type_traits<mood> : enum_type_traits<mood> {
+      static const char *name() { return "mood"; }
+      static std::vector<std::pair<mood, const char *>> labels() {
+        return { { mood::sad, "sad" }, { mood::ok, "ok" }, { mood::happy, "happy" } };
+      }
+    };
+  }
+}
+
 TEST(params_sync, datatypes) {
 
   Connection cnx;
@@ -43,6 +57,21 @@ TEST(params_sync, datatypes) {
 
 }
 
+TEST(params_sync, c_strings) {
+
+  Connection cnx;
+  cnx.connect();
+
+  char buf[] = "hello";
+  char *ptr = buf;
+  const char *cptr = buf;
+  EXPECT_EQ("hello", cnx.execute("SELECT $1", buf).as<std::string>(0));
+  EXPECT_EQ("hello", cnx.execute("SELECT $1", ptr).as<std::string>(0));
+  EXPECT_EQ("hello", cnx.execute("SELECT $1", cptr).as<std::string>(0));
+  EXPECT_EQ("hello world", cnx.execute("SELECT $1 || ' ' || $2", ptr, "world").as<std::string>(0));
+
+}
+
 TEST(params_sync, utf8) {
 
   Connection cnx;
@@ -93,6 +122,16 @@ TEST(param_sync, bytea_type) {
   std::vector<uint8_t> actual = cnx.execute("SELECT $1::bytea", expected).as<std::vector<uint8_t>>(0);
   EXPECT_TRUE(expected.size() == actual.size() && std::equal(actual.begin(), actual.end(), expected.begin()));
 
+  const char raw[] = "\x01\x02\x00\x03";
+  bytea_view view = cnx.execute("SELECT $1", bytea_view(raw, 4)).as<bytea_view>(0);
+  EXPECT_EQ(4, view.size);
+  EXPECT_TRUE(std::equal(view.begin(), view.end(), reinterpret_cast<const uint8_t *>(raw)));
+
+#ifdef LIBPQMXX_STRING_VIEW
+  std::string text("hello world");
+  EXPECT_EQ("hello", cnx.execute("SELECT $1", std::string_view(text).substr(0, 5)).as<std::string>(0));
+#endif
+
 }
 
 TEST(param_sync, array_types) {
@@ -184,3 +223,49 @@ TEST(param_sync, multi) {
 
 }
 
+
+TEST(param_sync, enum_type) {
+
+  Settings settings;
+  settings.types = std::make_shared<TypeCatalog>();
+
+  Connection cnx(settings);
+  cnx.connect();
+  cnx.execute("CREATE TYPE pg_temp.mood AS ENUM ('sad', 'ok', 'happy')");
+
+  const TypeInfo &type = cnx.type("mood");
+  EXPECT_EQ(type.kind, 'e');
+  EXPECT_EQ(type.labels, std::vector<std::string>({ "sad", "ok", "happy" }));
+  EXPECT_EQ(settings.types->find(type.oid), &type);
+  EXPECT_EQ(&cnx.type(type.oid), &type);
+
+  EXPECT_EQ(cnx.execute("SELECT $1", mood::happy).as<mood>(0), mood::happy);
+  EXPECT_EQ(cnx.execute("SELECT $1::text", mood::ok).as<std::string>(0), "ok");
+
+  std::vector<array_item<mood>> moods = { mood::sad, mood::happy };
+  auto &result = cnx.execute("SELECT $1", moods);
+  std::vector<array_item<mood>> read = result.asArray<mood>(0);
+  ASSERT_EQ(read.size(), 2);
+  EXPECT_EQ(read[0].value, mood::sad);
+  EXPECT_EQ(read[1].value, mood::happy);
+
+  EXPECT_THROW(cnx.type("no_such_type"), ExecutionException);
+
+}
+
+TEST(param_sync, container_arrays) {
+
+  Connection cnx;
+  cnx.connect();
+
+  std::vector<int32_t> ids = { 3, 1, 2 };
+  EXPECT_EQ(6, cnx.execute("SELECT SUM(id)::integer FROM unnest($1) id", ids).as<int32_t>(0));
+  EXPECT_TRUE(cnx.execute("SELECT 2 = ANY($1)", ids).as<bool>(0));
+
+  std::vector<std::string> names = { "Moe", "Larry" };
+  EXPECT_EQ("Moe,Larry", cnx.execute("SELECT array_to_string($1, ',')", names).as<std::string>(0));
+
+  double values[] = { 1.5, 2.5 };
+  EXPECT_EQ(4, cnx.execute("SELECT SUM(v) FROM unnest($1) v", make_array(values, 2)).as<double>(0));
+
+}
@@ -23,6 +23,9 @@
 #include "postgres-connection.h"
 #include "postgres-exceptions.h"
 
+#include <cmath>
+#include <limits>
+
 #define ARRAY(...) __VA_ARGS__
 #define TEST_VECTOR(expr, _expected, expected_size, type)                       \
 {                                                                               \
@@ -39,6 +42,40 @@
 
 using namespace db::postgres;
 
+struct money_t {
+  int64_t cents;
+};
+
+namespace db {
+  namespace postgres {
+    template<>
+    struct type_traits<money_t> {
+      static const Oid oid = CASHOID;
+      static const Oid arrayOid = CASHARRAYOID;
+      static bool accepts(Oid type) { return type == CASHOID; }
+      static int32_t length(const money_t &) { return 8; }
+      static char *write(const money_t &value, char *buf) { return postgres::write(value.cents, buf); }
+      static money_t read(const char *buf, int32_t length) { return money_t { read_value<int64_t>(buf, length) }; }
+      static money_t null() { return money_t { 0 }; }
+    };
+  }
+}
+
+struct point_t {
+  double x;
+  double y;
+};
+
+namespace db {
+  namespace postgres {
+    template<>
+    struct type_traits<point_t> : composite_type_traits<point_t> {
+      static const char *name() { return "point2d"; }
+      static std::tuple<double &, double &> tie(point_t &p) { return std::tie(p.x, p.y); }
+    };
+  }
+}
+
 TEST(result_sync, integer_types) {
 
   Connection cnx;
@@ -274,3 +311,302 @@ TEST(result_sync, column_name) {
   EXPECT_STREQ(u8"メインページ", result.columnName(3));
 
 }
+
+TEST(result_sync, custom_type) {
+
+  Connection cnx;
+  cnx.connect();
+
+  cnx.execute("SET lc_monetary TO 'C'");
+  EXPECT_EQ(1234, cnx.execute("SELECT 12.34::money").as<money_t>(0).cents);
+  EXPECT_EQ(-501, cnx.execute("SELECT $1", money_t { -501 }).as<money_t>(0).cents);
+
+  auto array = cnx.execute("SELECT ARRAY[1::money, NULL]").asArray<money_t>(0);
+  EXPECT_EQ(2, array.size());
+  EXPECT_EQ(100, array[0].value.cents);
+  EXPECT_TRUE(array[1].isNull);
+
+}
+
+TEST(result_sync, composite_types) {
+
+  Connection cnx;
+  cnx.connect();
+
+  auto record = cnx.execute("SELECT ROW(1, 'one'::text, NULL::float8)").as<std::tuple<int32_t, std::string, double>>(0);
+  EXPECT_EQ(1, std::get<0>(record));
+  EXPECT_EQ("one", std::get<1>(record));
+  EXPECT_EQ(0, std::get<2>(record));
+
+  auto records = cnx.execute("SELECT ARRAY[ROW(1, 'one'::text), ROW(2, 'two'::text), NULL]")
+                    .asArray<std::tuple<int32_t, std::string>>(0);
+  ASSERT_EQ(3, records.size());
+  EXPECT_EQ(2, std::get<0>(records[1].value));
+  EXPECT_EQ("two", std::get<1>(records[1].value));
+  EXPECT_TRUE(records[2].isNull);
+
+  typedef std::tuple<int32_t, int32_t> pair_t;
+  EXPECT_THROW(cnx.execute("SELECT ROW(1, 2, 3)").as<pair_t>(0), ExecutionException);
+
+  cnx.execute("CREATE TYPE pg_temp.point2d AS (x float8, y float8)");
+  point_t p = cnx.execute("SELECT $1", point_t { 1.5, -2 }).as<point_t>(0);
+  EXPECT_EQ(1.5, p.x);
+  EXPECT_EQ(-2, p.y);
+
+  std::vector<array_item<point_t>> points = { point_t { 1, 2 }, nullptr };
+  auto read = cnx.execute("SELECT $1", points).asArray<point_t>(0);
+  ASSERT_EQ(2, read.size());
+  EXPECT_EQ(2, read[0].value.y);
+  EXPECT_TRUE(read[1].isNull);
+
+}
+
+TEST(result_sync, range_types) {
+
+  Connection cnx;
+  cnx.connect();
+
+  auto r = cnx.execute("SELECT '[1,10]'::int4range").as<range<int32_t>>(0);
+  EXPECT_EQ(range<int32_t>(1, 11), r);
+  EXPECT_TRUE(r.contains(10));
+  EXPECT_FALSE(r.contains(11));
+
+  auto unbounded = cnx.execute("SELECT '(,5]'::int8range").as<range<int64_t>>(0);
+  EXPECT_TRUE(unbounded.lowerInfinite);
+  EXPECT_EQ(6, unbounded.upper);
+
+  EXPECT_TRUE(cnx.execute("SELECT 'empty'::daterange").as<range<date_t>>(0).empty);
+
+  range<timestamptz_t> slot(timestamptz_t { 0 }, timestamptz_t { 3600000000 }, true, true);
+  EXPECT_EQ(slot, cnx.execute("SELECT $1", slot).as<range<timestamptz_t>>(0));
+  EXPECT_TRUE(cnx.execute("SELECT $1 @> '1970-01-01 00:30:00+00'::timestamptz", slot).as<bool>(0));
+
+  std::vector<array_item<range<int32_t>>> ranges = { range<int32_t>(1, 2), nullptr, range<int32_t>() };
+  auto array = cnx.execute("SELECT $1", ranges).asArray<range<int32_t>>(0);
+  ASSERT_EQ(3, array.size());
+  EXPECT_EQ(range<int32_t>(1, 2), array[0].value);
+  EXPECT_TRUE(array[1].isNull);
+  EXPECT_TRUE(array[2].value.empty);
+
+}
+
+TEST(result_sync, network_types) {
+
+  Connection cnx;
+  cnx.connect();
+
+  auto &row = cnx.execute("SELECT '192.168.1.5/24'::inet, '2001:db8::/32'::cidr, '08:00:2b:01:02:03'::macaddr");
+  inet_t inet = row.as<inet_t>(0);
+  EXPECT_EQ(4, inet.family);
+  EXPECT_EQ(24, inet.bits);
+  EXPECT_EQ("192.168.1.5/24", inet.str());
+  cidr_t cidr = row.as<cidr_t>(1);
+  EXPECT_EQ(6, cidr.family);
+  EXPECT_EQ("2001:db8::/32", cidr.str());
+  EXPECT_EQ("08:00:2b:01:02:03", row.as<macaddr_t>(2).str());
+  EXPECT_EQ("2001:db8::/32", row.as<inet_t>(1).str());
+
+  EXPECT_TRUE(cnx.execute("SELECT $1 = '192.168.1.5/24'::inet", inet).as<bool>(0));
+  EXPECT_EQ(cidr, cnx.execute("SELECT $1", cidr).as<cidr_t>(0));
+
+  auto array = cnx.execute("SELECT ARRAY['10.0.0.1'::inet, NULL, '::1'::inet]").asArray<inet_t>(0);
+  ASSERT_EQ(3, array.size());
+  EXPECT_EQ("10.0.0.1", array[0].value.str());
+  EXPECT_TRUE(array[1].isNull);
+  EXPECT_EQ("::1", array[2].value.str());
+  EXPECT_TRUE(array[0].value < array[2].value);
+
+}
+
+TEST(result_sync, tsvector_type) {
+
+  Connection cnx;
+  cnx.connect();
+
+  auto &row = cnx.execute("SELECT 'fat:2,4 cat:3A rat'::tsvector");
+  tsvector_view tsvector = row.as<tsvector_view>(0);
+  EXPECT_EQ(3, tsvector.size());
+  std::vector<std::string> lexemes;
+  for (auto &lexeme: tsvector) {
+    lexemes.push_back(std::string(lexeme.lexeme, lexeme.length));
+  }
+  EXPECT_EQ(std::vector<std::string>({ "cat", "fat", "rat" }), lexemes);
+
+  auto cat = tsvector.begin();
+  ASSERT_EQ(1, cat->positions);
+  EXPECT_EQ(3, cat->position(0));
+  EXPECT_EQ('A', cat->weight(0));
+  ++cat;
+  ++cat;
+  EXPECT_EQ(0, cat->positions);
+
+}
+
+TEST(result_sync, chrono_types) {
+
+  using namespace std::chrono;
+  typedef time_point<system_clock, duration<int32_t, std::ratio<86400>>> days_t;
+
+  Connection cnx;
+  cnx.connect();
+
+  auto &row = cnx.execute("SELECT '2016-10-01 12:30:00+00'::timestamptz, '2016-10-01'::date, '1 day 00:00:01.5'::interval");
+  auto timestamp = row.as<system_clock::time_point>(0);
+  EXPECT_EQ(1475325000, duration_cast<seconds>(timestamp.time_since_epoch()).count());
+  EXPECT_EQ(17075, row.as<days_t>(1).time_since_epoch().count());
+  EXPECT_EQ(86401500, row.as<milliseconds>(2).count());
+
+  EXPECT_EQ(timestamp, cnx.execute("SELECT $1", timestamp).as<system_clock::time_point>(0));
+  EXPECT_EQ("2016-10-01", cnx.execute("SELECT $1::text", days_t(duration<int32_t, std::ratio<86400>>(17075))).as<std::string>(0));
+  EXPECT_EQ("00:01:30", cnx.execute("SELECT $1::text", seconds(90)).as<std::string>(0));
+
+  auto array = cnx.execute("SELECT ARRAY['1970-01-01 00:00:01+00'::timestamptz, NULL]").asArray<time_point<system_clock, microseconds>>(0);
+  ASSERT_EQ(2, array.size());
+  EXPECT_EQ(1000000, array[0].value.time_since_epoch().count());
+  EXPECT_TRUE(array[1].isNull);
+
+  // Infinite values are read as the min() and max() time points.
+  typedef time_point<system_clock, nanoseconds> nanoseconds_t;
+  auto &infinite = cnx.execute("SELECT 'infinity'::timestamptz, '-infinity'::timestamptz, 'infinity'::date, '-infinity'::date, '2500-01-01 00:00:00+00'::timestamptz");
+  EXPECT_EQ(nanoseconds_t::max(), infinite.as<nanoseconds_t>(0));
+  EXPECT_EQ(nanoseconds_t::min(), infinite.as<nanoseconds_t>(1));
+  EXPECT_EQ(days_t::max(), infinite.as<days_t>(2));
+  EXPECT_EQ(days_t::min(), infinite.as<days_t>(3));
+  EXPECT_EQ("infinity", cnx.execute("SELECT $1::text", days_t::max()).as<std::string>(0));
+
+  // Out of the range of 64 bit nanoseconds.
+  EXPECT_THROW(infinite.as<nanoseconds_t>(4), ExecutionException);
+  EXPECT_EQ(16725225600, duration_cast<seconds>(infinite.as<time_point<system_clock, microseconds>>(4).time_since_epoch()).count());
+
+}
+
+TEST(result_sync, text_array) {
+
+  Connection cnx;
+  cnx.connect();
+
+  text_array tags = cnx.execute("SELECT ARRAY['red', NULL, '', 'blue']::text[]").as<text_array>(0);
+  ASSERT_EQ(4, tags.size());
+  EXPECT_STREQ("red", tags[0]);
+  EXPECT_TRUE(tags.isNull(1));
+  EXPECT_EQ(nullptr, tags[1]);
+  EXPECT_EQ(0, tags.length(2));
+  EXPECT_EQ(4, tags.length(3));
+
+  EXPECT_EQ(0, cnx.execute("SELECT '{}'::varchar[]").as<text_array>(0).size());
+  EXPECT_EQ("{red,NULL,\"\",blue}", cnx.execute("SELECT $1::text", tags).as<std::string>(0));
+
+}
+
+TEST(result_sync, into) {
+
+  Connection cnx;
+  cnx.connect();
+
+  std::string name;
+  std::vector<uint8_t> bytes;
+  std::vector<int32_t> numbers;
+  auto &row = cnx.execute("SELECT 'Moe'::text, '\\xDEAD'::bytea, ARRAY[1, NULL, 3], NULL::text");
+  EXPECT_TRUE(row.into(0, name));
+  EXPECT_EQ("Moe", name);
+  EXPECT_TRUE(row.into(1, bytes));
+  EXPECT_EQ(std::vector<uint8_t>({ 0xDE, 0xAD }), bytes);
+  EXPECT_EQ(3, row.intoArray(2, numbers));
+  EXPECT_EQ(std::vector<int32_t>({ 1, 0, 3 }), numbers);
+  EXPECT_FALSE(row.into(3, name));
+  EXPECT_TRUE(name.empty());
+
+  std::vector<array_item<std::string>> names(10);
+  int rows = 0;
+  for (auto &row: cnx.execute("SELECT ARRAY['a', NULL] UNION ALL SELECT ARRAY['b', 'c', 'd']")) {
+    row.intoArray(0, names);
+    rows++;
+    if (rows == 1) {
+      ASSERT_EQ(2, names.size());
+      EXPECT_EQ("a", names[0].value);
+      EXPECT_TRUE(names[1].isNull);
+    }
+  }
+  ASSERT_EQ(3, names.size());
+  EXPECT_EQ("d", names[2].value);
+
+}
+
+TEST(result_sync, snapshot) {
+
+  Connection cnx;
+  cnx.connect();
+
+  std::vector<RowSnapshot> rows;
+  for (auto &row: cnx.execute("SELECT n, 'name ' || n, CASE WHEN n = 2 THEN NULL ELSE ARRAY[n, n] END FROM generate_series(1, 3) n")) {
+    rows.push_back(row.snapshot());
+  }
+
+  ASSERT_EQ(3, rows.size());
+  EXPECT_EQ(3, rows[0].columns());
+  EXPECT_STREQ("n", rows[0].columnName(0));
+  EXPECT_EQ(1, rows[0].as<int32_t>(0));
+  EXPECT_EQ("name 1", rows[0].as<std::string>(1));
+  EXPECT_EQ(2, rows[0].asArray<int32_t>(2).size());
+  EXPECT_EQ(3, rows[2].num());
+  EXPECT_TRUE(rows[1].isNull(2));
+  EXPECT_FALSE(rows[1].isNull(1));
+
+  std::string name;
+  EXPECT_TRUE(rows[2].into(1, name));
+  EXPECT_EQ("name 3", name);
+
+}
+
+TEST(result_sync, text_format) {
+
+  Connection cnx;
+  cnx.connect();
+
+  // Multiple statements are executed with the text format.
+  auto &result = cnx.execute(R"SQL(
+    SELECT 42::int8, -1.5::float8, 'Moe'::text, '2014-11-01'::date,
+           '2014-11-01 05:19:00.25'::timestamp, true, NULL::int4, '\xDEAD'::bytea;
+    SELECT 1;
+  )SQL");
+
+  EXPECT_EQ(42, result.as<int64_t>(0));
+  EXPECT_EQ(-1.5, result.as<double>(1));
+  EXPECT_EQ("Moe", result.as<std::string>(2));
+  EXPECT_EQ(1414800000, result.as<date_t>(3).epoch_date);
+  EXPECT_EQ(1414819140250000, result.as<timestamp_t>(4).epoch_time);
+  EXPECT_TRUE(result.as<bool>(5));
+  EXPECT_TRUE(result.isNull(6));
+  EXPECT_EQ(std::vector<uint8_t>({ 0xDE, 0xAD }), result.as<std::vector<uint8_t>>(7));
+
+  int64_t value;
+  EXPECT_TRUE(result.into(0, value));
+  EXPECT_EQ(42, value);
+
+  RowSnapshot snapshot = result.snapshot();
+  EXPECT_EQ(1414800000, snapshot.as<date_t>(3).epoch_date);
+  EXPECT_THROW(snapshot.as<std::chrono::system_clock::time_point>(4), ExecutionException);
+
+  // Malformed and out of range values throw.
+  auto &invalid = cnx.execute(R"SQL(
+    SELECT '1.5'::text, 'abc'::text, '99999999999'::text, '1,5'::text,
+           'NaN'::float8, '-Infinity'::float8, '-2147483648'::int4,
+           '\xzz'::text, '\x0g'::text, '\xdeAD'::text;
+    SELECT 1;
+  )SQL");
+
+  EXPECT_THROW(invalid.as<int32_t>(0), ExecutionException);
+  EXPECT_THROW(invalid.as<int32_t>(1), ExecutionException);
+  EXPECT_THROW(invalid.as<int32_t>(2), ExecutionException);
+  EXPECT_EQ(99999999999, invalid.as<int64_t>(2));
+  EXPECT_EQ(1.5, invalid.as<double>(0));
+  EXPECT_THROW(invalid.as<double>(1), ExecutionException);
+  EXPECT_THROW(invalid.as<double>(3), ExecutionException);
+  EXPECT_TRUE(std::isnan(invalid.as<double>(4)));
+  EXPECT_EQ(-std::numeric_limits<double>::infinity(), invalid.as<double>(5));
+  EXPECT_EQ(std::numeric_limits<int32_t>::min(), invalid.as<int32_t>(6));
+  EXPECT_THROW(invalid.as<std::vector<uint8_t>>(7), ExecutionException);
+  EXPECT_THROW(invalid.as<std::vector<uint8_t>>(8), ExecutionException);
+  EXPECT_EQ(std::vector<uint8_t>({ 0xDE, 0xAD }), invalid.as<std::vector<uint8_t>>(9));
+
+}
@@ -0,0 +1,92 @@
+/**
+ * Copyright (c) 2016 Philippe FERDINAND
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ **/
+#include "gtest/gtest.h"
+#include "postgres-connection.h"
+#include "postgres-exceptions.h"
+
+#include <set>
+#include <thread>
+
+using namespace db::postgres;
+
+TEST(single_flight, shared) {
+
+  Settings settings;
+  settings.flights = std::make_shared<SingleFlight>();
+
+  const int threads = 8;
+  std::vector<std::shared_ptr<const BufferedResult>> results(threads);
+  std::vector<std::thread> workers;
+  for (int i = 0; i < threads; i++) {
+    workers.push_back(std::thread([&, i] {
+      Connection cnx(settings);
+      cnx.connect();
+      results[i] = cnx.executeShared("SELECT $1::int4 + n FROM generate_series(1, 3) n, pg_sleep(0.5)", 10);
+    }));
+  }
+  for (auto &worker: workers) {
+    worker.join();
+  }
+
+  std::set<const BufferedResult *> distinct;
+  for (auto &result: results) {
+    ASSERT_TRUE(result != nullptr);
+    ASSERT_EQ(3, result->size());
+    distinct.insert(result.get());
+  }
+  EXPECT_LT(distinct.size(), size_t(threads));
+  EXPECT_EQ(0, settings.flights->size());
+
+  ThreadPool pool(0);
+  int32_t values[3];
+  results[0]->decode(pool, values);
+  EXPECT_EQ(11, values[0]);
+  EXPECT_EQ(13, values[2]);
+
+  // Different parameters are not shared.
+  Connection cnx(settings);
+  cnx.connect();
+  auto first = cnx.executeShared("SELECT $1::int4", 1);
+  auto second = cnx.executeShared("SELECT $1::int4", 2);
+  EXPECT_NE(first.get(), second.get());
+
+  // Connections to different databases do not share their queries.
+  std::shared_ptr<const BufferedResult> databases[2];
+  std::thread other([&] {
+    Connection template1(settings);
+    template1.connect("dbname=template1");
+    databases[1] = template1.executeShared("SELECT current_database()::text FROM pg_sleep(0.5)");
+  });
+  databases[0] = cnx.executeShared("SELECT current_database()::text FROM pg_sleep(0.5)");
+  other.join();
+  EXPECT_NE(databases[0].get(), databases[1].get());
+  std::string name;
+  databases[1]->decode(pool, &name);
+  EXPECT_EQ("template1", name);
+
+  // Without flights the query is simply executed.
+  Connection plain;
+  plain.connect();
+  EXPECT_EQ(1, plain.executeShared("SELECT 1")->size());
+  EXPECT_THROW(plain.executeShared("SELECT * FROM missing_table"), ExecutionException);
+
+}
@@ -23,6 +23,8 @@
 #include "postgres-connection.h"
 #include "postgres-exceptions.h"
 
+#include <thread>
+
 using namespace db::postgres;
 
 TEST(result_sync, statements) {
@@ -187,6 +189,108 @@ TEST(misc, cancel) {
 
 }
 
+TEST(misc, abandon) {
+
+  Connection cnx;
+  cnx.connect();
+
+  for (int i = 0; i < 3; i++) {
+    for (auto &row: cnx.execute("SELECT generate_series(1, 100000000)")) {
+      if (row.num() == 10) {
+        break;
+      }
+    }
+    EXPECT_EQ(2, cnx.execute("SELECT 2").as<int32_t>(0));
+  }
+
+  for (auto &row: cnx.execute("SELECT generate_series(1, 100000000)").prefetch()) {
+    if (row.num() == 10) {
+      break;
+    }
+  }
+  EXPECT_EQ(3, cnx.execute("SELECT 3").as<int32_t>(0));
+
+  // A query whose rows have all been received is not cancelled: the next
+  // command does not receive a late cancel request.
+  for (int i = 0; i < 20; i++) {
+    auto &result = cnx.execute("SELECT generate_series(1, 20)");
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    EXPECT_EQ(1, result.as<int32_t>(0));
+    EXPECT_NO_THROW(cnx.execute("SELECT pg_sleep(0.01)"));
+  }
+
+}
+
+TEST(misc, timeout) {
+
+  Connection cnx;
+  cnx.connect();
+
+  cnx.timeout(std::chrono::milliseconds(200));
+  EXPECT_THROW(cnx.execute("SELECT pg_sleep(10)"), TimeoutException);
+  EXPECT_THROW(cnx.executeBuffered("SELECT pg_sleep(10)"), TimeoutException);
+
+  // The connection is ready for the next command.
+  EXPECT_EQ(1, cnx.execute("SELECT 1").as<int32_t>(0));
+
+  cnx.timeout(std::chrono::milliseconds(0));
+  EXPECT_EQ(0, cnx.timeout().count());
+  cnx.execute("SELECT pg_sleep(0.3)");
+
+}
+
+TEST(misc, prepared) {
+
+  Connection cnx;
+  cnx.connect();
+
+  cnx.prepare("typed", "SELECT $1::date + 1, $2::int8 * 2, $3::numeric::text, $4::uuid::text, $5::int2");
+
+  auto &result = cnx.executePrepared("typed", "2014-11-01", 21, "1.25", "a0eebc99-9c0b-4ef8-bb6d-6bb9bd380a11", 3);
+  EXPECT_EQ(1414886400, result.as<date_t>(0).epoch_date);
+  EXPECT_EQ(42, result.as<int64_t>(1));
+  EXPECT_EQ("1.25", result.as<std::string>(2));
+  EXPECT_EQ("a0eebc99-9c0b-4ef8-bb6d-6bb9bd380a11", result.as<std::string>(3));
+  EXPECT_EQ(3, result.as<int16_t>(4));
+
+  EXPECT_THROW(cnx.executePrepared("typed", "2014-11-01", 21, "1.25", nullptr, 100000), ExecutionException);
+  EXPECT_THROW(cnx.executePrepared("typed", 1), ExecutionException);
+  EXPECT_THROW(cnx.executePrepared("unknown"), ExecutionException);
+  EXPECT_EQ(1, cnx.execute("SELECT 1").as<int32_t>(0));
+
+}
+
+TEST(misc, statement_registry) {
+
+  Settings settings;
+  settings.statements = std::make_shared<StatementRegistry>();
+  settings.statements->add("square", "SELECT $1 * $1", { INT8OID })
+                      .add("series", "SELECT generate_series(1, $1)");
+
+  Connection cnx(settings);
+  cnx.connect();
+  EXPECT_EQ(49, cnx.executePrepared("square", 7).as<int64_t>(0));
+
+  int32_t sum = 0;
+  for (auto &row: cnx.executePrepared("series", 4)) {
+    sum += row.as<int32_t>(0);
+  }
+  EXPECT_EQ(10, sum);
+
+  // Declared once the connection is opened.
+  settings.statements->add("cube", "SELECT $1::int8 * $1 * $1");
+  EXPECT_EQ(27, cnx.executePrepared("cube", 3).as<int64_t>(0));
+
+  EXPECT_NO_THROW(settings.statements->add("square", "SELECT $1 * $1", { INT8OID }));
+  EXPECT_THROW(settings.statements->add("square", "SELECT $1"), ExecutionException);
+
+  settings.statements->add("invalid", "SELECT FROM WHERE");
+  Connection other(settings);
+  EXPECT_THROW(other.connect(), ExecutionException);
+  EXPECT_EQ(1, other.execute("SELECT 1").as<int32_t>(0));
+
+}
+
 TEST(misc, is_single_statement) {
 
   //
@@ -0,0 +1,84 @@
+/**
+ * Copyright (c) 2016 Philippe FERDINAND
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ **/
+#include "gtest/gtest.h"
+#include "postgres-write-coalescer.h"
+#include "postgres-exceptions.h"
+
+#include <thread>
+
+using namespace db::postgres;
+
+TEST(write_coalescer, insert) {
+
+  Connection cnx;
+  cnx.connect();
+  cnx.execute("CREATE TEMP TABLE events (id integer, name text)");
+
+  {
+    WriteCoalescer<int32_t, std::string> events(cnx,
+      "INSERT INTO events (id, name) SELECT * FROM unnest($1::int[], $2::text[])",
+      64, std::chrono::milliseconds(5));
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 8; i++) {
+      threads.push_back(std::thread([&, i] {
+        std::vector<std::future<void>> futures;
+        for (int j = 0; j < 100; j++) {
+          futures.push_back(events.insert(i * 100 + j, "event " + std::to_string(j)));
+        }
+        for (auto &future: futures) {
+          future.get();
+        }
+      }));
+    }
+    for (auto &thread: threads) {
+      thread.join();
+    }
+  }
+
+  auto &result = cnx.execute("SELECT count(*), count(DISTINCT id), min(id), max(id) FROM events");
+  EXPECT_EQ(800, result.as<int64_t>(0));
+  EXPECT_EQ(800, result.as<int64_t>(1));
+  EXPECT_EQ(0, result.as<int32_t>(2));
+  EXPECT_EQ(799, result.as<int32_t>(3));
+
+}
+
+TEST(write_coalescer, error) {
+
+  Connection cnx;
+  cnx.connect();
+  cnx.execute("CREATE TEMP TABLE events (id integer PRIMARY KEY)");
+
+  std::future<void> first, second;
+  {
+    WriteCoalescer<int32_t> events(cnx,
+      "INSERT INTO events (id) SELECT * FROM unnest($1::int[])",
+      16, std::chrono::seconds(10));
+    first = events.insert(1);
+    second = events.insert(1);
+  }
+  EXPECT_THROW(first.get(), ExecutionException);
+  EXPECT_THROW(second.get(), ExecutionException);
+  EXPECT_EQ(0, cnx.execute("SELECT count(*) FROM events").as<int64_t>(0));
+
+}